@@ -66,6 +66,9 @@ the rest of our app to easily read and write data to the SD card in a csv format
 JazaSD jazaSD;   //The global utility of the JazaSD class (with external linkage)
 char sdWriteBuf[SD_BUF_SIZE]; //Buffer for writing to the SD card (externally linked!)
 char sdBuf[SD_BUF_SIZE];       //I think SDFat uses a 512 byte buffer for writing....
+#if JAZASD_ENABLE_ASYNC_WRITES
+char asyncWorkerBuf[SD_BUF_SIZE]; //Worker thread's own scratch so it can't clobber pointers into sdBuf
+#endif
 char filePathBuf[100];
 
 SPISettings my_spi_settings(10 * MHZ, MSBFIRST, SPI_MODE0);
@@ -76,10 +79,21 @@ SPISettings my_spi_settings(10 * MHZ, MSBFIRST, SPI_MODE0);
 //Debug logging object
 static Logger myLog(mes_obj_sd);
 //SDFat library objects
+#if JAZASD_HOST_IMAGE && ENABLE_TIMING_CARD_CLASS
+SdFatTiming sd;      //Card image timed as a real card would be
+#elif JAZASD_HOST_IMAGE
+SdFatImage sd;       //Card image file standing in for the SD card
+#elif JAZASD_USE_SD_EX
+SdFatEX sd;          //SDFat with extended multi-block transfers
+#else
 SdFat sd;            //The instance of the SDFat utility
+#endif
 SdFile file;   //Instance of the SdFile class (from SDFat library)
 SdFile archiveFile; //File used during archiving process
 SdFile copyFile;
+SdFile catalogFile; //Sorted catalog of archive folders (see ARCHIVE_CATALOG_NAME)
+FatScanner fatScanner; //Time-sliced FAT scan (see serviceFatScan())
+bool FAT_SCAN_ACTIVE = false;
 
 int sd_free_space_KB = 0;
 
@@ -91,6 +105,10 @@ bool SD_FAT_DEBUG_ENABLED = false;  //Global flag for enabling/disabling SPI deb
 
 JAZA_FILES_t currentlyOpenFile = NUM_TYPES_JAZA_FILES;
 
+#if JAZASD_ENABLE_ASYNC_WRITES
+volatile unsigned int asyncErrorLine = 0;   //Line of an SD error hit by the worker, handled on the app thread
+#endif
+
 unsigned int lastGetEntryNum = 0;
 int lastGetEntryStartPos = 0;
 
@@ -111,6 +129,126 @@ JazaFile_t jazaFiles[NUM_TYPES_JAZA_FILES]  = {
    [FILE_JP_HEX_FILE]      = JazaFile_t("firmware.hex")
 };
 
+/*=============================================>>>>>
+= Call metrics =
+===============================================>>>>>*/
+//JAZASD_METRIC(op) at the top of a function times the whole call with an
+//object on the stack.  With JAZASD_ENABLE_METRICS 0 both macros are empty.
+//Nested calls (e.g. syncFile inside fileEntry) are counted in both.
+#if JAZASD_ENABLE_METRICS
+enum JAZASD_OP_t{
+   JAZASD_OP_BEGIN,
+   JAZASD_OP_SET_HEADERS,
+   JAZASD_OP_WIPE_FILE,
+   JAZASD_OP_REPLACE_FILE,
+   JAZASD_OP_COPY_FILE,
+   JAZASD_OP_FREE_SPACE,
+   JAZASD_OP_ARCHIVE_FILES,
+   JAZASD_OP_ERASE_ARCHIVES,
+   JAZASD_OP_RESTORE_ARCHIVE,
+   JAZASD_OP_ARCHIVE_RETENTION,
+   JAZASD_OP_FAT_SCAN,
+   JAZASD_OP_GOTO_ENTRY,
+   JAZASD_OP_GET_ENTRY,
+   JAZASD_OP_GET_ENTRY_AT,
+   JAZASD_OP_SEARCH_ENTRY,
+   JAZASD_OP_FILE_ENTRY,
+   JAZASD_OP_REPLACE_ENTRY,
+   JAZASD_OP_INSERT_ENTRY,
+   JAZASD_OP_OVERWRITE_BYTES,
+   JAZASD_OP_READ_BYTES,
+   JAZASD_OP_BYTES_IN_FILE,
+   JAZASD_OP_NUM_ENTRIES,
+   JAZASD_OP_SYNC_FILE,
+   JAZASD_OP_FILE_OPEN,
+   NUM_TYPES_JAZASD_OP //Must always be last item in enum!
+};
+
+const char* const jazaOpNames[NUM_TYPES_JAZASD_OP] = {
+   [JAZASD_OP_BEGIN]             = "begin",
+   [JAZASD_OP_SET_HEADERS]       = "setHeaders",
+   [JAZASD_OP_WIPE_FILE]         = "wipeFile",
+   [JAZASD_OP_REPLACE_FILE]      = "replaceFile",
+   [JAZASD_OP_COPY_FILE]         = "copyFile",
+   [JAZASD_OP_FREE_SPACE]        = "freeSpaceKB",
+   [JAZASD_OP_ARCHIVE_FILES]     = "archiveFiles",
+   [JAZASD_OP_ERASE_ARCHIVES]    = "eraseArchives",
+   [JAZASD_OP_RESTORE_ARCHIVE]   = "restoreArchive",
+   [JAZASD_OP_ARCHIVE_RETENTION] = "retention",
+   [JAZASD_OP_FAT_SCAN]          = "fatScan",
+   [JAZASD_OP_GOTO_ENTRY]        = "gotoEntry",
+   [JAZASD_OP_GET_ENTRY]         = "getEntry",
+   [JAZASD_OP_GET_ENTRY_AT]      = "getEntryObjAt",
+   [JAZASD_OP_SEARCH_ENTRY]      = "searchGetEntry",
+   [JAZASD_OP_FILE_ENTRY]        = "fileEntry",
+   [JAZASD_OP_REPLACE_ENTRY]     = "replaceEntry",
+   [JAZASD_OP_INSERT_ENTRY]      = "insertEntry",
+   [JAZASD_OP_OVERWRITE_BYTES]   = "overWriteBytes",
+   [JAZASD_OP_READ_BYTES]        = "readBytes",
+   [JAZASD_OP_BYTES_IN_FILE]     = "bytesInFile",
+   [JAZASD_OP_NUM_ENTRIES]       = "numEntries",
+   [JAZASD_OP_SYNC_FILE]         = "syncFile",
+   [JAZASD_OP_FILE_OPEN]         = "smartFileOpen"
+};
+
+struct JazaOpStats_t{
+   uint32_t count;
+   uint32_t bytes;
+   uint32_t blockReads;
+   uint32_t blockWrites;
+   uint16_t latency[JAZASD_METRIC_BINS];
+};
+
+JazaOpStats_t jazaOpStats[NUM_TYPES_JAZASD_OP];
+
+class JazaOpTimer{
+public:
+   JazaOpTimer(JAZASD_OP_t op){
+      opType = op;
+      numBytes = 0;
+      #if USE_FAT_IO_COUNTERS
+      startReads = sd.vol()->blockReadCount();
+      startWrites = sd.vol()->blockWriteCount();
+      #endif
+      startMicros = micros();
+   }
+
+   ~JazaOpTimer(){
+      uint32_t elapsedMicros = micros() - startMicros;
+      JazaOpStats_t* stats = &jazaOpStats[opType];
+      uint8_t bin = 0;
+      while((elapsedMicros >>= 1) && bin < (JAZASD_METRIC_BINS - 1)) bin++;
+      if(stats->latency[bin] < 0XFFFF) stats->latency[bin]++;
+      stats->count++;
+      stats->bytes += numBytes;
+      #if USE_FAT_IO_COUNTERS
+      stats->blockReads += sd.vol()->blockReadCount() - startReads;
+      stats->blockWrites += sd.vol()->blockWriteCount() - startWrites;
+      #endif
+   }
+
+   void addBytes(uint32_t bytes){
+      numBytes += bytes;
+   }
+
+private:
+   JAZASD_OP_t opType;
+   uint32_t numBytes;
+   uint32_t startMicros;
+   #if USE_FAT_IO_COUNTERS
+   uint32_t startReads;
+   uint32_t startWrites;
+   #endif
+};
+
+#define JAZASD_METRIC(op) JazaOpTimer opTimer(op)
+#define JAZASD_METRIC_BYTES(numBytes) opTimer.addBytes(numBytes)
+#else
+#define JAZASD_METRIC(op)
+#define JAZASD_METRIC_BYTES(numBytes)
+#endif
+
+
 /*=============================================>>>>>
 = Function forward declarations =
 ===============================================>>>>>*/
@@ -127,6 +265,21 @@ bool hasADelimiter(JAZA_FILES_t fileType, const char* targDelimiter);
 // bool goToNextEntry(JAZA_FILES_t fileType);
 uint32_t getCurrentEntryNumber(JAZA_FILES_t fileType, uint32_t seekSpecific = 0);
 
+bool catalogOpen();
+bool catalogSorted();
+bool catalogClose();
+uint32_t catalogNumRecords();
+bool catalogReadRecord(uint32_t index, JazaArchiveRecord_t &record);
+bool catalogWriteRecord(uint32_t index, const JazaArchiveRecord_t &record);
+bool catalogLowerBound(uint32_t targStamp, uint32_t &index);
+bool catalogUpsertRecord(const JazaArchiveRecord_t &record);
+bool catalogRemoveRecords(uint32_t index, uint32_t numRecords);
+bool catalogRebuild();
+
+bool onAsyncWorker();
+void asyncWriteBarrier();
+char* scratchBuf();
+
 
 /*= End of Function forward declarations =*/
 /*=============================================<<<<<*/
@@ -150,6 +303,14 @@ uint32_t getCurrentEntryNumber(JAZA_FILES_t fileType, uint32_t seekSpecific = 0)
 ===============================================>>>>>*/
 uint32_t last_sd_recovery_attempt = 0;
 void SD_error_handler(unsigned int lineNum){
+   #if JAZASD_ENABLE_ASYNC_WRITES
+   //Recovery power-cycles the card and publishes, so leave it to the app thread
+   //(asyncWriteBarrier() calls back in here once the queue has emptied)
+   if(onAsyncWorker()){
+      if(!asyncErrorLine) asyncErrorLine = lineNum;
+      return;
+   }
+   #endif
    //Debug print
    myLog.warn("SD error handler! -- ");
    //Set global SD utility state variables
@@ -247,10 +408,30 @@ void dateTime(uint16_t* date, uint16_t* time) {
 }
 
 
+/*=============================================>>>>>
+= Callback that SDFat library calls from long card waits =
+===============================================>>>>>*/
+#if USE_SD_YIELD_CALLBACK
+volatile bool SD_YIELD_PENDING = false;   //A long card wait happened, run the system loop once it's over
+
+//Called at most every SD_YIELD_CALLBACK_MICROS while the card is busy, so a
+//slow write or erase can't starve the watchdog.  The card is selected and the
+//SPI transaction is open, so anything that could call back into JazaSD (the
+//system loop included) is left to syncFile() once the SD call has returned.
+void sdYield(uint16_t elapsedMS, uint8_t reason) {
+   (void)elapsedMS;
+   (void)reason;
+   HW_Watchdog.pat();
+   SD_YIELD_PENDING = true;
+}
+#endif
+
+
 /*=============================================>>>>>
 = Function that syncs the currently open file to the SD card =
 ===============================================>>>>>*/
 bool syncFile(unsigned int lineNum, SdFile* targFile = NULL){
+   JAZASD_METRIC(JAZASD_OP_SYNC_FILE);
 
    //IF autosync is disabled then quit
    if(!SD_AUTOSYNC_ENABLED){
@@ -263,7 +444,8 @@ bool syncFile(unsigned int lineNum, SdFile* targFile = NULL){
    //Cooldown after publishing
    //(avoids writing to SD card right after publish when cell is transmitting)
    while(lastPublishTimer.elapsedTime() < MIN_MS_BEFORE_SD_WRITE_AFTER_PUBLISH){
-      Particle_Process();
+      if(onAsyncWorker()) delay(1);
+      else Particle_Process();
       #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY_AF
       myLog.warn("SD Waiting for post-publish cooldown");
       #endif
@@ -283,9 +465,28 @@ bool syncFile(unsigned int lineNum, SdFile* targFile = NULL){
    //Sync the file
    bool syncSuccess = targFile->sync();
 
+   #if USE_ASYNC_BLOCK_IO
+   //Let the system thread run while the card programs the last block
+   if(syncSuccess){
+      int8_t pollResult;
+      while((pollResult = sd.card()->poll()) == 0){
+         if(!onAsyncWorker()) Particle_Process();
+      }
+      syncSuccess = pollResult > 0;
+   }
+   #endif
+
    //Save timestamp of last SD write
    last_sd_write_millis = millis();
 
+   #if USE_SD_YIELD_CALLBACK
+   //Catch up on the system loop the card wait held off (see sdYield())
+   if(SD_YIELD_PENDING && !onAsyncWorker()){
+      SD_YIELD_PENDING = false;
+      Particle_Process();
+   }
+   #endif
+
    if(!syncSuccess){
       SD_error_handler(lineNum);
       return false;
@@ -306,11 +507,46 @@ bool smartFileClose(){
    }
    return true;
 }
+
+
+#if FAT_DIR_SYNC_LAG
+/*=============================================>>>>>
+= Function that recovers file sizes after a reset =
+===============================================>>>>>*/
+//syncFile() lets the size in a file's directory entry lag the logged data
+//until the file is closed, so a reset can leave the size short of the data
+bool recoverFileSizes(){
+   SdFile workerFile;
+
+   for(unsigned int count = 0; count <= NUM_TYPES_JAZA_FILES; count++){
+      const char* fileName = (count < NUM_TYPES_JAZA_FILES) ? jazaFiles[count].name : ARCHIVE_CATALOG_NAME;
+      if(!workerFile.open(fileName, O_RDWR)) continue;
+      #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY
+      uint32_t oldSize = workerFile.fileSize();
+      #endif
+      if(!workerFile.recoverSize()){
+         workerFile.close();
+         return false;
+      }
+      #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY
+      if(workerFile.fileSize() != oldSize){
+         myLog.info("Recovered %s size %lu -> %lu", fileName, oldSize, workerFile.fileSize());
+      }
+      #endif
+      if(!workerFile.close()) return false;
+   }
+   return true;
+}
+#endif
 /*=============================================>>>>>
 = Function for opening files =
 ===============================================>>>>>*/
 //Function open the corresponding sdFat file for the passed jazaFile
 bool smartFileOpen(JAZA_FILES_t fileType){
+   JAZASD_METRIC(JAZASD_OP_FILE_OPEN);
+
+   //Let queued writes finish before touching the card
+   asyncWriteBarrier();
 
    // #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY_AF
    // myLog.info("smartFileOpen %s", jazaFiles[fileType].name);
@@ -366,6 +602,208 @@ bool smartFileOpen(JAZA_FILES_t fileType){
 }
 
 
+/*=============================================>>>>>
+= Asynchronous write queue =
+===============================================>>>>>*/
+//Writes are copied into a fixed ring of command slots and carried out in order
+//by a worker thread, so the app thread doesn't block while the card programs.
+//Only the worker touches the card while writes are queued: every other
+//JazaSD call waits for the queue to empty (asyncWriteBarrier()) first.
+#if JAZASD_ENABLE_ASYNC_WRITES
+enum JAZASD_CMD_t{
+   JAZASD_CMD_FILE_ENTRY,
+   JAZASD_CMD_REPLACE_ENTRY,
+   JAZASD_CMD_OVERWRITE_BYTES
+};
+
+struct JazaSDCommand_t{
+   uint8_t cmdType = JAZASD_CMD_FILE_ENTRY;
+   JAZA_FILES_t fileType = NUM_TYPES_JAZA_FILES;
+   uint32_t arg = 0;                //entryNum or startByte
+   bool deleteOperation = false;
+   bool hasData = false;            //False for a NULL newEntry
+   uint32_t seqNum = 0;
+   char data[JAZASD_QUEUE_DATA_SIZE];
+};
+
+JazaSDCommand_t asyncQueue[JAZASD_QUEUE_SLOTS];
+volatile uint8_t asyncQueueHead = 0;   //Slot the worker is on
+volatile uint8_t asyncQueueCount = 0;  //Slots in use (including the one being written)
+volatile uint32_t asyncQueuedSeq = 0;  //Sequence number of the last queued write
+volatile uint32_t asyncDoneSeq = 0;    //Sequence number of the last finished write
+volatile bool ASYNC_WRITES_ENABLED = false;
+volatile bool ASYNC_WRITE_FAILED = false;
+JazaSDWriteCallback_t asyncWriteCallback = NULL;
+Mutex asyncQueueLock;
+Thread* asyncWorker = NULL;
+os_semaphore_t asyncWorkSignal = NULL;  //Given for each queued write, the idle worker waits on it
+os_semaphore_t asyncDoneSignal = NULL;  //Given for each finished write, full queue and barrier wait on it
+
+
+//Worker thread that owns the SD card while writes are queued
+void asyncWorkerLoop(void* param){
+   (void)param;
+   while(true){
+      JazaSDCommand_t* cmd = NULL;
+      asyncQueueLock.lock();
+      if(asyncQueueCount) cmd = &asyncQueue[asyncQueueHead];
+      asyncQueueLock.unlock();
+
+      if(!cmd){
+         //Sleep until asyncEnqueue() hands over a write
+         os_semaphore_take(asyncWorkSignal, CONCURRENT_WAIT_FOREVER, false);
+         continue;
+      }
+
+      bool success = false;
+      switch(cmd->cmdType){
+         case JAZASD_CMD_FILE_ENTRY:
+            success = jazaSD.fileEntry(cmd->fileType, cmd->data);
+            break;
+         case JAZASD_CMD_REPLACE_ENTRY:
+            success = jazaSD.replaceEntry(cmd->fileType, cmd->arg, cmd->hasData ? cmd->data : NULL, cmd->deleteOperation);
+            break;
+         case JAZASD_CMD_OVERWRITE_BYTES:
+            success = jazaSD.overWriteBytes(cmd->fileType, cmd->arg, cmd->data);
+            break;
+      }
+      uint32_t seqNum = cmd->seqNum;
+
+      #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY
+      myLog.trace("Queued write #%lu done (%s)", seqNum, success?"TRUE":"FALSE");
+      #endif
+      //Report it before the slot is freed, so flush() returns after the last callback
+      if(asyncWriteCallback) asyncWriteCallback(seqNum, success);
+
+      //Free the slot
+      asyncQueueLock.lock();
+      asyncQueueHead = (asyncQueueHead + 1) % JAZASD_QUEUE_SLOTS;
+      asyncQueueCount--;
+      asyncDoneSeq = seqNum;
+      if(!success) ASYNC_WRITE_FAILED = true;
+      asyncQueueLock.unlock();
+      os_semaphore_give(asyncDoneSignal, false);
+   }
+}
+
+
+//Function that queues a write, returns its sequence number or 0 if it can't be queued
+uint32_t asyncEnqueue(uint8_t cmdType, JAZA_FILES_t fileType, uint32_t arg, const char* data, bool deleteOperation){
+   if(data && strlen(data) >= JAZASD_QUEUE_DATA_SIZE) return 0;
+   //Let the app thread recover the card before queueing more writes at it
+   if(asyncErrorLine) asyncWriteBarrier();
+
+   //Wait for a free slot
+   while(true){
+      asyncQueueLock.lock();
+      if(asyncQueueCount < JAZASD_QUEUE_SLOTS) break;
+      asyncQueueLock.unlock();
+      Particle_Process();
+      os_semaphore_take(asyncDoneSignal, JAZASD_ASYNC_WAIT_MS, false);
+   }
+   JazaSDCommand_t* cmd = &asyncQueue[(asyncQueueHead + asyncQueueCount) % JAZASD_QUEUE_SLOTS];
+   cmd->cmdType = cmdType;
+   cmd->fileType = fileType;
+   cmd->arg = arg;
+   cmd->deleteOperation = deleteOperation;
+   cmd->hasData = (data != NULL);
+   snprintf(cmd->data, JAZASD_QUEUE_DATA_SIZE, "%s", data ? data : "");
+   cmd->seqNum = ++asyncQueuedSeq;
+   asyncQueueCount++;
+   asyncQueueLock.unlock();
+   os_semaphore_give(asyncWorkSignal, false);
+
+   return cmd->seqNum;
+}
+#endif
+
+
+bool onAsyncWorker(){
+   #if JAZASD_ENABLE_ASYNC_WRITES
+   return asyncWorker && asyncWorker->isCurrent();
+   #else
+   return false;
+   #endif
+}
+
+
+//Scratch buffer for the calling thread (SD_BUF_SIZE bytes either way)
+char* scratchBuf(){
+   #if JAZASD_ENABLE_ASYNC_WRITES
+   if(onAsyncWorker()) return asyncWorkerBuf;
+   #endif
+   return sdBuf;
+}
+
+
+//Function that waits until every queued write has been carried out
+void asyncWriteBarrier(){
+   #if JAZASD_ENABLE_ASYNC_WRITES
+   if(onAsyncWorker()) return;
+   //Returns at once with nothing queued, else sleeps until the worker finishes a write
+   while(asyncDoneSeq != asyncQueuedSeq){
+      Particle_Process();
+      os_semaphore_take(asyncDoneSignal, JAZASD_ASYNC_WAIT_MS, false);
+   }
+   //Run the recovery the worker put off
+   if(asyncErrorLine){
+      unsigned int lineNum = asyncErrorLine;
+      asyncErrorLine = 0;
+      SD_error_handler(lineNum);
+   }
+   #endif
+}
+
+
+#if JAZASD_ENABLE_ASYNC_WRITES
+bool JazaSD::setAsyncWrites(bool enable, JazaSDWriteCallback_t callback){
+   if(enable && !asyncWorkSignal){
+      if(os_semaphore_create(&asyncWorkSignal, JAZASD_QUEUE_SLOTS, 0) ||
+         os_semaphore_create(&asyncDoneSignal, JAZASD_QUEUE_SLOTS, 0)){
+         asyncWorkSignal = NULL;
+         printError(myLog, __LINE__, mes_err_thrown);
+         return false;
+      }
+   }
+   if(enable && !asyncWorker){
+      asyncWorker = new Thread("jazaSD", asyncWorkerLoop, NULL, OS_THREAD_PRIORITY_DEFAULT, JAZASD_WORKER_STACK_SIZE);
+      if(!asyncWorker){
+         printError(myLog, __LINE__, mes_err_thrown);
+         return false;
+      }
+   }
+   //Let queued writes finish before going back to synchronous writes
+   if(!enable) asyncWriteBarrier();
+   asyncWriteCallback = callback;
+   ASYNC_WRITES_ENABLED = enable;
+   return true;
+}
+
+
+bool JazaSD::asyncWritesEnabled(){
+   return ASYNC_WRITES_ENABLED;
+}
+
+
+uint32_t JazaSD::lastQueuedWrite(){
+   return asyncQueuedSeq;
+}
+
+
+bool JazaSD::writeDone(uint32_t seqNum){
+   return (int32_t)(asyncDoneSeq - seqNum) >= 0;
+}
+
+
+bool JazaSD::flush(){
+   asyncWriteBarrier();
+   bool success = !ASYNC_WRITE_FAILED;
+   ASYNC_WRITE_FAILED = false;
+   return success;
+}
+#endif
+
+
 /*=============================================>>>>>
 = HELPER FUNCTIONS INSIDE A FILE =
 ===============================================>>>>>*/
@@ -396,6 +834,8 @@ uint32_t skipPastNextDelimiter(JAZA_FILES_t fileType, const char* targDelimiter)
    uint32_t origPos = file.curPosition();
    //Determine the length of the delimiter we're looking for
    uint8_t delimiterLength = strlen(targDelimiter);
+   //sdBuf, or the worker's own buffer for a queued write
+   char* buf = scratchBuf();
    //Control bool that will break while loop once whole file has been searched
    bool endOfFileReached = false;
    //Loop through file until we have reached the end of file
@@ -410,7 +850,7 @@ uint32_t skipPastNextDelimiter(JAZA_FILES_t fileType, const char* targDelimiter)
       printFreeMem();
       #endif
       //Fill our SD analysis buffer
-      int bytesRead = file.read(sdBuf, SD_BUF_SIZE);
+      int bytesRead = file.read(buf, SD_BUF_SIZE);
       //Error check on the read
       if(bytesRead < 0){
          SD_error_handler(__LINE__);
@@ -419,11 +859,11 @@ uint32_t skipPastNextDelimiter(JAZA_FILES_t fileType, const char* targDelimiter)
       //Variable that stores whether or not we have reached the end of file
       endOfFileReached = (bytesRead < SD_BUF_SIZE);
       //Define a char pointer that will point to location in our buf where the delimiter is found
-      char* delimPtr = strstr(sdBuf, targDelimiter);
+      char* delimPtr = strstr(buf, targDelimiter);
       //Did we find a match?
       if(delimPtr){
 
-         unsigned int delimStartChar = searchStartPos + (delimPtr - sdBuf);
+         unsigned int delimStartChar = searchStartPos + (delimPtr - buf);
          #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_SUPER_HEAVY_AF
          myLog.trace("Found delimiter at char %u", delimStartChar);
          #endif
@@ -734,6 +1174,17 @@ bool JazaSD::replaceEntry(JAZA_FILES_t fileType, uint32_t entryNum, const char*
       return false;
    }
 
+   #if JAZASD_ENABLE_ASYNC_WRITES
+   if(ASYNC_WRITES_ENABLED && !onAsyncWorker()){
+      if(asyncEnqueue(JAZASD_CMD_REPLACE_ENTRY, fileType, entryNum, newEntry, deleteOperation)) return true;
+      //Too long to queue, write it here once the queue has emptied
+      asyncWriteBarrier();
+   }
+   #endif
+   //Timed here so queued writes are only counted once, on the worker
+   JAZASD_METRIC(JAZASD_OP_REPLACE_ENTRY);
+   JAZASD_METRIC_BYTES(newEntry ? strlen(newEntry) : 0);
+
    #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY_AF
    myLog.trace("replaceEntry(\"%s\")", jazaFiles[fileType].name);
    #endif
@@ -829,13 +1280,14 @@ bool JazaSD::replaceEntry(JAZA_FILES_t fileType, uint32_t entryNum, const char*
    #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY
    myLog.trace("TOTAL CHARS TO BE SHIFTED = %lu", file_chars_to_shift);
    #endif
-   //Shift as many characters as possible into sdBuf
-   int static_RAM_chars_stored = file.read(sdBuf, (SD_BUF_SIZE - 1));   //Save null-terminating character
+   //Shift as many characters as possible into sdBuf (or the worker's buffer)
+   char* buf = scratchBuf();
+   int static_RAM_chars_stored = file.read(buf, (SD_BUF_SIZE - 1));   //Save null-terminating character
    //Null terminate the sdBuf
-   sdBuf[static_RAM_chars_stored] = '\0';
+   buf[static_RAM_chars_stored] = '\0';
 
    #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY_AF
-   myLog.trace("sdBuf[] is \"%s\"", getEscapedStr(sdBuf));
+   myLog.trace("sdBuf[] is \"%s\"", getEscapedStr(buf));
    #endif
 
    if((static_RAM_chars_stored < 0)  || ( abs(static_RAM_chars_stored) > (SD_BUF_SIZE-1)) ){
@@ -908,10 +1360,10 @@ bool JazaSD::replaceEntry(JAZA_FILES_t fileType, uint32_t entryNum, const char*
 
    //Debug
    #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY_AF
-   myLog.trace("Writing to byte #%lu --> \"%s\" ", file.curPosition(), getEscapedStr(sdBuf));
+   myLog.trace("Writing to byte #%lu --> \"%s\" ", file.curPosition(), getEscapedStr(buf));
    #endif
    //Write to file
-   writeResult = file.write( sdBuf, static_RAM_chars_stored );
+   writeResult = file.write( buf, static_RAM_chars_stored );
 
    if(writeResult < 0){
       printError(myLog, __LINE__, mes_sd_writeError);
@@ -935,6 +1387,8 @@ bool JazaSD::replaceEntry(JAZA_FILES_t fileType, uint32_t entryNum, const char*
 
 
 bool JazaSD::insertEntry(JAZA_FILES_t fileType, uint32_t entryNum, const char* newEntry){
+   JAZASD_METRIC(JAZASD_OP_INSERT_ENTRY);
+   JAZASD_METRIC_BYTES(newEntry ? strlen(newEntry) : 0);
 
    if(!SD_INITIALIZED){
       #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY_AF
@@ -970,10 +1424,12 @@ bool JazaSD::insertEntry(JAZA_FILES_t fileType, uint32_t entryNum, const char* n
    myLog.info("file.read() - L%u", __LINE__);
    printFreeMem();
    #endif
-   bytesToLoad = file.read(sdBuf, (SD_BUF_SIZE-1) );
-   if( bytesToLoad < 0 ){
+   int bytesRead = file.read(sdBuf, (SD_BUF_SIZE-1) );
+   if( bytesRead < 0 ){
       printError(myLog, __LINE__, mes_sd_readError);
+      return false;
    }
+   bytesToLoad = bytesRead;
    //Set file position
    #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_SUPER_HEAVY_AF
    myLog.info("file.seekSet() - L%u", __LINE__);
@@ -1028,6 +1484,7 @@ to a char array containing the entire entry that the 1st matched string is in
 */
 
 char* JazaSD::searchGetEntry(JAZA_FILES_t fileType, const char* searchStr, uint16_t targInstanceNum){
+   JAZASD_METRIC(JAZASD_OP_SEARCH_ENTRY);
 
 
    if(!SD_INITIALIZED) return NULL;
@@ -1041,7 +1498,7 @@ char* JazaSD::searchGetEntry(JAZA_FILES_t fileType, const char* searchStr, uint1
    //myLog.trace(mes_gen_parsing);
    //initialize pass by reference return value
    //A variable we'll use throughout:
-   uint8_t searchStrLen = strlen(searchStr);
+   uint16_t searchStrLen = strlen(searchStr);
    //Do some basic error checks
    if( !(searchStr && (searchStrLen>0) && (searchStrLen < sizeof(sdBuf)) ) ){
       printError(myLog, __LINE__, mes_inValid);
@@ -1167,6 +1624,9 @@ char* JazaSD::searchGetEntry(JAZA_FILES_t fileType, const char* searchStr, uint1
 bool SD_INITIALIZED = false;
 
 void JazaSD::begin(){
+   JAZASD_METRIC(JAZASD_OP_BEGIN);
+
+   asyncWriteBarrier();
 
    myLog.info("Initializing JazaSD");
    Serial.flush();
@@ -1198,7 +1658,11 @@ void JazaSD::begin(){
    #endif
 
    //Initialize the SD card object
+   #if JAZASD_HOST_IMAGE
+   if (!sd.begin(JAZASD_HOST_IMAGE_PATH)) {
+   #else
    if (!sd.begin(chipSelect, my_spi_settings)) {
+   #endif
       //Initialization error
       SD_error_handler(__LINE__);
       //Done
@@ -1210,6 +1674,19 @@ void JazaSD::begin(){
    //Setup dateTime callback
    SdFile::dateTimeCallback(dateTime);
 
+   #if USE_SD_YIELD_CALLBACK && !JAZASD_HOST_IMAGE
+   //Keep the system serviced during long card waits
+   SdSpiCard::yieldCallback(sdYield);
+   #endif
+
+   #if FAT_DIR_SYNC_LAG
+   //Fix up sizes left behind by a reset before anything is appended
+   if(!recoverFileSizes()){
+      SD_error_handler(__LINE__);
+      return;
+   }
+   #endif
+
    #ifdef TEST_MODE_WIPE_SD_ON_STARTUP
    delay(100);
    printWarning(myLog, __LINE__, "WIPING SD CARD!");
@@ -1267,6 +1744,7 @@ void JazaSD::begin(){
 
 //Function to pass a pointer to the header string to use for the specified file type
 void JazaSD::setHeaders(JAZA_FILES_t fileType, const char* headers, bool skipIfExists){
+   JAZASD_METRIC(JAZASD_OP_SET_HEADERS);
    if(!SD_INITIALIZED) return;
 
    #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY_AF
@@ -1300,6 +1778,7 @@ void JazaSD::setHeaders(JAZA_FILES_t fileType, const char* headers, bool skipIfE
 ===============================================>>>>>*/
 
 bool JazaSD::wipeFile(JAZA_FILES_t fileType){
+   JAZASD_METRIC(JAZASD_OP_WIPE_FILE);
    if(smartFileOpen(fileType)){
       #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_SUPER_HEAVY_AF
       myLog.info("file.truncate() - L%u", __LINE__);
@@ -1310,6 +1789,7 @@ bool JazaSD::wipeFile(JAZA_FILES_t fileType){
 }
 
 bool JazaSD::replaceFile(JAZA_FILES_t fileToReplace, JAZA_FILES_t replacementFile){
+   JAZASD_METRIC(JAZASD_OP_REPLACE_FILE);
    #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY_AF
    myLog.warn(
       "Replacing file contents of \"%s\" with contents of \"%s\"",
@@ -1317,6 +1797,8 @@ bool JazaSD::replaceFile(JAZA_FILES_t fileToReplace, JAZA_FILES_t replacementFil
       jazaFiles[fileToReplace].name
    );
    #endif
+
+   asyncWriteBarrier();
    //First delete target file
    if(sd.remove(jazaFiles[fileToReplace].name)){
       //Then rename the replacement file to target file's name
@@ -1392,6 +1874,8 @@ void JazaSD::printFileStructure(FatFile* baseDir, unsigned int indent){
 
    if(!SD_INITIALIZED) return;
 
+   asyncWriteBarrier();
+
    if(!baseDir){
       baseDir = sd.vwd();
       printHeaderBreak("SD FILE STRUCTURE");
@@ -1399,51 +1883,47 @@ void JazaSD::printFileStructure(FatFile* baseDir, unsigned int indent){
 
    baseDir->rewind();
 
-   FatFile workerFile;
+   FatDirEntry_t entries[DIR_ENTRY_BATCH_SIZE];
+   FatFile subDir;
+   uint32_t dirPos;
+   int count;
 
    #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_SUPER_HEAVY_AF
-   myLog.info("workerFile.openNext() - L%u", __LINE__);
-   #endif
-   while (workerFile.openNext(baseDir, O_READ)) {
-      // gotIntoLoop = true;
-      #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_SUPER_HEAVY_AF
-      myLog.info("file.printFileSize() - L%u", __LINE__);
-      #endif
-      workerFile.printFileSize(&Serial);
-      Serial.print("   ");
-      #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_SUPER_HEAVY_AF
-      myLog.info("file.printModifyDateTime() - L%u", __LINE__);
-      #endif
-      workerFile.printModifyDateTime(&Serial);
-      Serial.print("   ");
-      Serial.printf("%*s", indent, "");
-      #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_SUPER_HEAVY_AF
-      myLog.info("file.printName() - L%u", __LINE__);
-      #endif
-      workerFile.printName(&Serial);
-      #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_SUPER_HEAVY_AF
-      myLog.info("file.isDir() - L%u", __LINE__);
-      #endif
-      if (workerFile.isDir()) {
-         // Indicate a directory.
-         Serial.println('/');
-         // #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG
-         // myLog.info("Recursing!");
-         // #endif
-         //Recurse
-         printFileStructure(&workerFile, indent + 5);
+   myLog.info("baseDir->readDirEntries() - L%u", __LINE__);
+   #endif
+   while ((count = baseDir->readDirEntries(entries, DIR_ENTRY_BATCH_SIZE)) > 0) {
+      //Opening a subdirectory moves baseDir, so remember where this batch ended
+      dirPos = baseDir->curPosition();
+      for (int i = 0; i < count; i++) {
+         Serial.printf("%10lu   ", entries[i].fileSize);
+         FatFile::printFatDate(&Serial, entries[i].modifyDate);
+         Serial.print(' ');
+         FatFile::printFatTime(&Serial, entries[i].modifyTime);
+         Serial.print("   ");
+         Serial.printf("%*s", indent, "");
+         Serial.print(entries[i].name);
+         if (entries[i].isDir()) {
+            // Indicate a directory.
+            Serial.println('/');
+            //Recurse
+            #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_SUPER_HEAVY_AF
+            myLog.info("subDir.open() - L%u", __LINE__);
+            #endif
+            if (subDir.open(baseDir, entries[i].dirIndex, O_READ)) {
+               printFileStructure(&subDir, indent + 5);
+               subDir.close();
+            }
+         }
+         Serial.println();
       }
-      Serial.println();
-      #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_SUPER_HEAVY_AF
-      myLog.info("workerFile.close() - L%u", __LINE__);
-      #endif
-      workerFile.close();
+      if (!baseDir->seekSet(dirPos)) break;
    }//End while
 }
 #endif
 
 
 bool JazaSD::copyFile(const char* sourcePath, const char* targPath){
+   JAZASD_METRIC(JAZASD_OP_COPY_FILE);
 
    if(!SD_INITIALIZED){
       #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY
@@ -1452,6 +1932,8 @@ bool JazaSD::copyFile(const char* sourcePath, const char* targPath){
       return false;
    }
 
+   asyncWriteBarrier();
+
    int targFileSize = 0;
    int bytesWritten = 0;
    int bytesRead = 0;
@@ -1530,6 +2012,7 @@ bool JazaSD::copyFile(const char* sourcePath, const char* targPath){
 
       //Increment bytesWritten variable
       bytesWritten += bytesRead;
+      JAZASD_METRIC_BYTES(bytesRead);
 
    };
    //Sync the archive file from RAM to the SD CARD
@@ -1547,7 +2030,61 @@ bool JazaSD::copyFile(const char* sourcePath, const char* targPath){
 
 
 
+/*=============================================>>>>>
+= Time-sliced FAT scan =
+===============================================>>>>>*/
+//Function that starts a scan of the FAT (free count, largest free run, fragmentation)
+bool JazaSD::startFatScan(){
+   if(!SD_INITIALIZED) return false;
+
+   asyncWriteBarrier();
+   FAT_SCAN_ACTIVE = fatScanner.begin(sd.vol());
+   return FAT_SCAN_ACTIVE;
+}
+
+
+//Function that scans a slice of the FAT.  Call it from the main loop until it
+//returns FatScanner::SCAN_DONE so the watchdog and cell stack keep being serviced
+int8_t JazaSD::serviceFatScan(uint16_t maxBlocks, uint32_t maxMicros){
+   JAZASD_METRIC(JAZASD_OP_FAT_SCAN);
+   if(!FAT_SCAN_ACTIVE) return FatScanner::SCAN_DONE;
+   if(!SD_INITIALIZED){
+      FAT_SCAN_ACTIVE = false;
+      return FatScanner::SCAN_ERROR;
+   }
+
+   asyncWriteBarrier();
+
+   int8_t scanResult = fatScanner.step(maxBlocks, maxMicros);
+
+   if(scanResult == FatScanner::SCAN_ERROR){
+      FAT_SCAN_ACTIVE = false;
+      SD_error_handler(__LINE__);
+   }
+   else if(scanResult == FatScanner::SCAN_DONE){
+      FAT_SCAN_ACTIVE = false;
+      #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG
+      myLog.info(
+         "FAT scan done: %lu free clusters | largest free run %lu at %lu%s",
+         fatScanner.freeCount(),
+         fatScanner.largestFreeRun(),
+         fatScanner.largestFreeRunStart(),
+         fatScanner.isStale() ? " | STALE" : ""
+      );
+      #endif
+      //Correct the maintained free count if nothing changed during the scan
+      if(fatScanner.setVolumeFreeCount()){
+         freeSpaceKB();
+      }
+   }
+   return scanResult;
+}
+
+
 unsigned int JazaSD::freeSpaceKB(){
+   JAZASD_METRIC(JAZASD_OP_FREE_SPACE);
+   asyncWriteBarrier();
+
    unsigned int clusterSize = 512L*sd.vol()->blocksPerCluster();
    int freeClusters = sd.vol()->freeClusterCount();
    if(freeClusters < 0) return 0;
@@ -1560,16 +2097,288 @@ unsigned int JazaSD::freeSpaceKB(){
 #define FOLDER_PATH_BUF_SIZE 15
 #define FILE_PATH_BUF_SIZE 50
 
+
+/*=============================================>>>>>
+= Archive catalog helper functions =
+===============================================>>>>>*/
+//The catalog is a file of fixed-width "stamp,sizeBytes,status" records sorted
+//by stamp, so finding an archive is a binary search over the records and
+//pruning old archives is a delete of the first N records (no directory walk)
+
+//Function that returns the bytes a file of the passed size occupies on the card
+uint32_t clusterRoundedSize(uint32_t numBytes){
+   uint32_t clusterBytes = 512UL*sd.vol()->blocksPerCluster();
+   return ((numBytes + clusterBytes - 1)/clusterBytes)*clusterBytes;
+}
+
+//Function that totals the card space used by an archive folder
+uint32_t archiveDirSize(FatFile* archiveDir, uint16_t &numFiles){
+   //The folder itself takes up a cluster
+   uint32_t sizeBytes = clusterRoundedSize(1);
+   FatDirEntry_t entries[DIR_ENTRY_BATCH_SIZE];
+   int count;
+
+   numFiles = 0;
+   archiveDir->rewind();
+   while((count = archiveDir->readDirEntries(entries, DIR_ENTRY_BATCH_SIZE)) > 0){
+      for(int i = 0; i < count; i++){
+         sizeBytes += clusterRoundedSize(entries[i].fileSize);
+      }
+      numFiles += count;
+   }
+   return sizeBytes;
+}
+
+//readDirEntries() filter that keeps folders named with an archive timestamp
+int8_t archiveDirFilter(const FatDirEntry_t* entry, void* arg){
+   (void)arg;
+   unsigned long stamp;
+   if(!entry->isDir()) return 0;
+   if(1 != sscanf(entry->name, "%lu", &stamp)) return 0;
+   return (stamp > ARCHIVE_STAMP_MIN && stamp < ARCHIVE_STAMP_MAX) ? 1 : 0;
+}
+
+//Function that opens the catalog (rebuilding it from the root directory if it doesn't exist yet)
+bool catalogChecked = false;   //catalogSorted() has been run since boot
+
+bool catalogOpen(){
+   if(catalogFile.isOpen()) return true;
+
+   bool catalogExists = sd.exists(ARCHIVE_CATALOG_NAME);
+   #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_SUPER_HEAVY_AF
+   myLog.info("catalogFile.open() - L%u", __LINE__);
+   #endif
+   if(!catalogFile.open(ARCHIVE_CATALOG_NAME, O_CREAT | O_READ | O_WRITE)){
+      #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY
+      myLog.error("Failed to open archive catalog");
+      #endif
+      return false;
+   }
+   if(!catalogExists){
+      #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG
+      myLog.info("No archive catalog, rebuilding from root directory");
+      #endif
+      return catalogRebuild();
+   }
+   //Drop a partially written trailing record (power lost mid-write)
+   if(catalogFile.fileSize() % ARCHIVE_CATALOG_RECORD_SIZE){
+      if(!catalogFile.truncate(catalogNumRecords()*ARCHIVE_CATALOG_RECORD_SIZE)) return false;
+   }
+   //Once per boot, make sure a reset didn't leave a shift half done
+   if(!catalogChecked){
+      catalogChecked = true;
+      if(!catalogSorted()){
+         #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG
+         myLog.warn("Archive catalog out of order, rebuilding from root directory");
+         #endif
+         return catalogRebuild();
+      }
+   }
+   return true;
+}
+
+//Function that checks every record parses and the stamps strictly increase.
+//A reset during catalogRemoveRecords() or catalogUpsertRecord() leaves a
+//record repeated or out of place, which this catches.
+bool catalogSorted(){
+   JazaArchiveRecord_t record;
+   uint32_t lastStamp = 0;
+
+   for(uint32_t index = 0; index < catalogNumRecords(); index++){
+      if(!catalogReadRecord(index, record)) return false;
+      if(index && record.stamp <= lastStamp) return false;
+      lastStamp = record.stamp;
+   }
+   return true;
+}
+
+//Function that syncs and closes the catalog
+bool catalogClose(){
+   if(!catalogFile.isOpen()) return true;
+   bool syncSuccess = syncFile(__LINE__, &catalogFile);
+   return catalogFile.close() && syncSuccess;
+}
+
+uint32_t catalogNumRecords(){
+   return catalogFile.fileSize()/ARCHIVE_CATALOG_RECORD_SIZE;
+}
+
+bool catalogReadRecord(uint32_t index, JazaArchiveRecord_t &record){
+   char recordBuf[ARCHIVE_CATALOG_RECORD_SIZE + 1];
+
+   if(!catalogFile.seekSet(index*ARCHIVE_CATALOG_RECORD_SIZE)){
+      printError(myLog, __LINE__, mes_sd_fileSeekError);
+      return false;
+   }
+   if(catalogFile.read(recordBuf, ARCHIVE_CATALOG_RECORD_SIZE) != ARCHIVE_CATALOG_RECORD_SIZE){
+      printError(myLog, __LINE__, mes_sd_readError);
+      return false;
+   }
+   recordBuf[ARCHIVE_CATALOG_RECORD_SIZE] = 0;
+   //%lu needs an unsigned long, which isn't 32 bits everywhere
+   unsigned long stamp, sizeBytes;
+   if(3 != sscanf(recordBuf, "%lu,%lu,%c", &stamp, &sizeBytes, &record.status)){
+      printError(myLog, __LINE__, mes_inValid);
+      return false;
+   }
+   record.stamp = stamp;
+   record.sizeBytes = sizeBytes;
+   return true;
+}
+
+bool catalogWriteRecord(uint32_t index, const JazaArchiveRecord_t &record){
+   char recordBuf[ARCHIVE_CATALOG_RECORD_SIZE + 1];
+
+   snprintf(recordBuf, sizeof(recordBuf), "%10lu,%10lu,%c\r\n", (unsigned long)record.stamp, (unsigned long)record.sizeBytes, record.status);
+   if(!catalogFile.seekSet(index*ARCHIVE_CATALOG_RECORD_SIZE)){
+      printError(myLog, __LINE__, mes_sd_fileSeekError);
+      return false;
+   }
+   if(catalogFile.write(recordBuf, ARCHIVE_CATALOG_RECORD_SIZE) != ARCHIVE_CATALOG_RECORD_SIZE){
+      printError(myLog, __LINE__, mes_sd_writeError);
+      return false;
+   }
+   return true;
+}
+
+//Function that finds the index of the first record with a stamp >= targStamp
+bool catalogLowerBound(uint32_t targStamp, uint32_t &index){
+   JazaArchiveRecord_t record;
+   uint32_t lo = 0;
+   uint32_t hi = catalogNumRecords();
+
+   while(lo < hi){
+      uint32_t mid = lo + (hi - lo)/2;
+      if(!catalogReadRecord(mid, record)) return false;
+      if(record.stamp < targStamp){
+         lo = mid + 1;
+      }
+      else{
+         hi = mid;
+      }
+   }
+   index = lo;
+   return true;
+}
+
+//Function that updates the record with the same stamp, or inserts it in sorted position
+bool catalogUpsertRecord(const JazaArchiveRecord_t &record){
+   JazaArchiveRecord_t workerRecord;
+   uint32_t numRecords = catalogNumRecords();
+   uint32_t index = 0;
+
+   if(!catalogLowerBound(record.stamp, index)) return false;
+
+   if(index < numRecords){
+      if(!catalogReadRecord(index, workerRecord)) return false;
+      if(workerRecord.stamp == record.stamp){
+         return catalogWriteRecord(index, record);
+      }
+   }
+   //Shift the records after the insert point back by one (usually there are none)
+   for(uint32_t count = numRecords; count > index; count--){
+      if(!catalogReadRecord(count - 1, workerRecord)) return false;
+      if(!catalogWriteRecord(count, workerRecord)) return false;
+   }
+   return catalogWriteRecord(index, record);
+}
+
+//Function that deletes numRecords records starting at index by shifting the rest forward
+//(not atomic: catalogOpen() rebuilds the catalog if a reset interrupts it)
+bool catalogRemoveRecords(uint32_t index, uint32_t numRecords){
+   uint32_t readPos = (index + numRecords)*ARCHIVE_CATALOG_RECORD_SIZE;
+   uint32_t writePos = index*ARCHIVE_CATALOG_RECORD_SIZE;
+   uint32_t endPos = catalogNumRecords()*ARCHIVE_CATALOG_RECORD_SIZE;
+   int bytesToMove = 0;
+
+   if(numRecords == 0 || writePos >= endPos) return true;
+   if(readPos > endPos) readPos = endPos;
+
+   while(readPos < endPos){
+      bytesToMove = endPos - readPos;
+      if(bytesToMove > SD_BUF_SIZE - 1) bytesToMove = SD_BUF_SIZE - 1;
+      if(!catalogFile.seekSet(readPos) || catalogFile.read(sdBuf, bytesToMove) != bytesToMove){
+         printError(myLog, __LINE__, mes_sd_readError);
+         return false;
+      }
+      if(!catalogFile.seekSet(writePos) || catalogFile.write(sdBuf, bytesToMove) != bytesToMove){
+         printError(myLog, __LINE__, mes_sd_writeError);
+         return false;
+      }
+      readPos += bytesToMove;
+      writePos += bytesToMove;
+   }
+   return catalogFile.truncate(writePos);
+}
+
+//Function that recreates the catalog with one walk of the root directory
+bool catalogRebuild(){
+   JazaArchiveRecord_t record;
+   FatFile archiveDir;
+   FatDirEntry_t entries[DIR_ENTRY_BATCH_SIZE];
+   uint32_t dirPos;
+   uint16_t numFiles = 0;
+   unsigned long stamp;
+   int count;
+
+   if(!catalogFile.truncate(0)) return false;
+
+   // Only folders named with a unix timestamp are returned
+   sd.vwd()->rewind();
+   while((count = sd.vwd()->readDirEntries(entries, DIR_ENTRY_BATCH_SIZE, archiveDirFilter)) > 0){
+      //Opening an archive folder moves the root directory, so remember where this batch ended
+      dirPos = sd.vwd()->curPosition();
+      for(int i = 0; i < count; i++){
+         if(!archiveDir.open(sd.vwd(), entries[i].dirIndex, O_READ)) return false;
+         sscanf(entries[i].name, "%lu", &stamp);
+         record.stamp = stamp;
+         record.sizeBytes = archiveDirSize(&archiveDir, numFiles);
+         record.status = (numFiles >= NUM_TYPES_JAZA_FILES) ? ARCHIVE_STATUS_COMPLETE : ARCHIVE_STATUS_INCOMPLETE;
+         archiveDir.close();
+         if(!catalogUpsertRecord(record)) return false;
+      }
+      if(!sd.vwd()->seekSet(dirPos)) return false;
+   }
+   if(count < 0) return false;
+   #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG
+   myLog.info("Archive catalog rebuilt with %lu archives", (unsigned long)catalogNumRecords());
+   #endif
+   return true;
+}
+
+
+bool JazaSD::rebuildArchiveCatalog(){
+   if(!SD_INITIALIZED){
+      #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY
+      myLog.error("No Init! L%u", __LINE__);
+      #endif
+      return false;
+   }
+
+   asyncWriteBarrier();
+   //Delete the old catalog so that opening it walks the root directory again
+   if(catalogFile.isOpen()) catalogFile.close();
+   if(sd.exists(ARCHIVE_CATALOG_NAME)) sd.remove(ARCHIVE_CATALOG_NAME);
+
+   bool rebuildSuccess = catalogOpen();
+   archiveBytesKnown = false;
+   return catalogClose() && rebuildSuccess;
+}
+
+
 bool JazaSD::archiveFiles(){
+   JAZASD_METRIC(JAZASD_OP_ARCHIVE_FILES);
    if(!SD_INITIALIZED){
       #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY
       myLog.error("No Init! L%u", __LINE__);
       #endif
       return false;
    }
+
+   asyncWriteBarrier();
    //Create a folder for the archive to live in=
    char folderPathBuf[FOLDER_PATH_BUF_SIZE] = {0};
-   snprintf(folderPathBuf, FOLDER_PATH_BUF_SIZE, "%lu", the_time);
+   snprintf(folderPathBuf, FOLDER_PATH_BUF_SIZE, "%lu", (unsigned long)the_time);
    if(!sd.mkdir(folderPathBuf)){
       #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY
       myLog.error("Failed to create archive directory \"%s\"", folderPathBuf);
@@ -1577,7 +2386,19 @@ bool JazaSD::archiveFiles(){
       return false;
    }
 
-
+   //Record the archive as pending in the catalog before copying anything into it
+   JazaArchiveRecord_t archiveRecord;
+   archiveRecord.stamp = the_time;
+   archiveRecord.sizeBytes = clusterRoundedSize(1);
+   archiveRecord.status = ARCHIVE_STATUS_PENDING;
+   if(!catalogOpen() || !catalogUpsertRecord(archiveRecord) || !catalogClose()){
+      #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY
+      myLog.error("Failed to add archive \"%s\" to catalog", folderPathBuf);
+      #endif
+      catalogClose();
+      return false;
+   }
+   archiveRecord.status = ARCHIVE_STATUS_COMPLETE;
 
    char filePathBuf[FILE_PATH_BUF_SIZE] = {0};
 
@@ -1604,9 +2425,25 @@ bool JazaSD::archiveFiles(){
          #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG
          myLog.info("Created archive %s", filePathBuf);
          #endif
+         archiveRecord.sizeBytes += clusterRoundedSize(file.fileSize());
+      }
+      else{
+         archiveRecord.status = ARCHIVE_STATUS_INCOMPLETE;
       }
 
    }//End FOR each file loop
+
+   //Save the final size and status of the archive to the catalog
+   if(!catalogOpen() || !catalogUpsertRecord(archiveRecord) || !catalogClose()){
+      #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY
+      myLog.error("Failed to update archive \"%s\" in catalog", folderPathBuf);
+      #endif
+      catalogClose();
+      return false;
+   }
+   //Account for the new archive without rescanning the FAT
+   archiveBytes += archiveRecord.sizeBytes;
+   sd_free_space_KB -= archiveRecord.sizeBytes/1024;
    #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG
    myLog.info("archiveFiles() -> Success!");
    #endif
@@ -1626,106 +2463,245 @@ bool JazaSD::archiveFiles(){
 
 
 bool JazaSD::eraseArchives(unsigned int beforeDate){
+   JAZASD_METRIC(JAZASD_OP_ERASE_ARCHIVES);
    if(!SD_INITIALIZED){
       #ifdef TEST_MODE_VERBOSE_ARCHIVE_DELETE
       myLog.error("No Init! L%u", __LINE__);
       #endif
       return false;
    }
-   //Array to store unix timestamps of archive dates
-   unsigned int archiveFoldersFound = 0;
-   unsigned int archiveFoldersDeleted = 0;
-   char filePathBuf[FILE_PATH_BUF_SIZE] = {0};
-   unsigned int timeStamp = 0;
 
-   // #ifdef TEST_MODE_VERBOSE_ARCHIVE_DELETE
-   // myLog.info("smartFileClose() - L%u", __LINE__);
-   // #endif
+   asyncWriteBarrier();
+   JazaArchiveRecord_t archiveRecord;
+   uint32_t archiveFoldersFound = 0;
+   uint32_t archiveFoldersDeleted = 0;
+   uint32_t bytesErased = 0;
+   char folderPathBuf[FOLDER_PATH_BUF_SIZE] = {0};
+
    if(file.isOpen()) if(!smartFileClose()) return false;
 
-   sd.vwd()->rewind();
+   if(!catalogOpen()) return false;
 
-   // #ifdef TEST_MODE_VERBOSE_ARCHIVE_DELETE
-   // myLog.info("file.openNext() - L%u", __LINE__);
-   // #endif
-   while (file.openNext(sd.vwd(), O_READ)) {
-      // #ifdef TEST_MODE_VERBOSE_ARCHIVE_DELETE
-      // myLog.info("file.isDir() - L%u", __LINE__);
-      // #endif
-      if (file.isDir()) {
-         //Get the directory name
-         // #ifdef TEST_MODE_VERBOSE_ARCHIVE_DELETE
-         // myLog.info("file.getName() - L%u", __LINE__);
-         // #endif
-         file.getName(filePathBuf, 50);
-         // Indicate a directory.
-         #ifdef TEST_MODE_VERBOSE_ARCHIVE_DELETE
-         // myLog.info("file.printFileSize() - L%u", __LINE__);
-         file.printName(&Serial);
-         Serial.print(" | ");
-         file.printFileSize(&Serial);
-         Serial.print(" bytes | ");
-         Serial.print(" ");
-         // myLog.info("file.printModifyDateTime() - L%u", __LINE__);
-         file.printModifyDateTime(&Serial);
-         Serial.print(" | ");
-         Serial.print(filePathBuf);
-         Serial.print(" | ");
-         #endif
-         // Check if this directory has a name that is a unix timestamp
-         if(1 == sscanf(filePathBuf, "%u", &timeStamp)){
-            if(timeStamp > 1300000000 && timeStamp < 2220000000){ //2011 to 2040
-               //Found an archive file
-               archiveFoldersFound++;
-               #ifdef TEST_MODE_VERBOSE_ARCHIVE_DELETE
-               Serial.print("--> unix folder confirmed");
-               #endif
-               if(
-                  (timeStamp < beforeDate) ||
-                  //erase all archive files if no beforeDate provided
-                  (beforeDate == 0)
-               ){
-                  //Delete this archive folder
-                  #ifdef TEST_MODE_VERBOSE_ARCHIVE_DELETE
-                  // myLog.info("file.rmRfStar() - L%u", __LINE__);
-                  Serial.print("--> deleting...");
-                  #endif
-                  if(!file.rmRfStar()){
-                     // #ifdef TEST_MODE_VERBOSE_ARCHIVE_DELETE
-                     // myLog.error("Failed to recursively delete archive directory");
-                     // #endif
-                     Serial.print(" --> error!");
-                     return false;
-                  }
-                  //Increment archiveFolders removed counter
-                  archiveFoldersDeleted++;
-                  #ifdef TEST_MODE_VERBOSE_ARCHIVE_DELETE
-                  Serial.print("  ~~>DELETED ARCHIVE FOLDER!");
-                  #endif
-               }
-            }
+   //Catalog is sorted, so the archives to erase are the first records
+   archiveFoldersFound = catalogNumRecords();
+   uint32_t numToDelete = archiveFoldersFound;
+   //erase all archive files if no beforeDate provided
+   if(beforeDate != 0){
+      if(!catalogLowerBound(beforeDate, numToDelete)){
+         catalogClose();
+         return false;
+      }
+   }
+
+   //Mark the records first, so a reset part way through never leaves restoreArchive()
+   //pointing at a half deleted folder
+   for(uint32_t index = 0; index < numToDelete; index++){
+      if(!catalogReadRecord(index, archiveRecord)){
+         catalogClose();
+         return false;
+      }
+      if(archiveRecord.status == ARCHIVE_STATUS_DELETING) continue;
+      archiveRecord.status = ARCHIVE_STATUS_DELETING;
+      if(!catalogWriteRecord(index, archiveRecord)){
+         catalogClose();
+         return false;
+      }
+   }
+   if(!syncFile(__LINE__, &catalogFile)){
+      catalogClose();
+      return false;
+   }
+
+   for(archiveFoldersDeleted = 0; archiveFoldersDeleted < numToDelete; archiveFoldersDeleted++){
+      if(!catalogReadRecord(archiveFoldersDeleted, archiveRecord)) break;
+      snprintf(folderPathBuf, FOLDER_PATH_BUF_SIZE, "%lu", (unsigned long)archiveRecord.stamp);
+      bytesErased += archiveRecord.sizeBytes;
+      #ifdef TEST_MODE_VERBOSE_ARCHIVE_DELETE
+      Serial.printf("%s | %lu bytes | %c --> deleting...", folderPathBuf, (unsigned long)archiveRecord.sizeBytes, archiveRecord.status);
+      #endif
+      //A folder that's already gone (deleted by hand) just drops out of the catalog
+      if(file.open(sd.vwd(), folderPathBuf, O_READ)){
+         if(!file.rmRfStar()){
+            Serial.println(" --> error!");
+            smartFileClose();
+            break;
          }
-         Serial.println();
+         smartFileClose();
       }
-      //Finally, close the file --> IMPORTANT!
-      // #ifdef TEST_MODE_VERBOSE_ARCHIVE_DELETE
-      // myLog.info("smartFileClose() - L%u", __LINE__);
-      // #endif
-      smartFileClose();
+      #ifdef TEST_MODE_VERBOSE_ARCHIVE_DELETE
+      Serial.println("  ~~>DELETED ARCHIVE FOLDER!");
+      #endif
    }
 
+   //Range delete the erased archives from the catalog
+   bool eraseSuccess = (archiveFoldersDeleted == numToDelete);
+   if(!catalogRemoveRecords(0, archiveFoldersDeleted)) eraseSuccess = false;
+   if(!catalogClose()) eraseSuccess = false;
+   //Recount archive sizes next time they're needed
+   archiveBytesKnown = false;
+   //Take the free space from the volume's count, or estimate it (an unknown count
+   //would be a full FAT walk here, serviceArchiveRetention() seeds it a slice at a time)
+   if(sd.vol()->freeClusterCountKnown()) freeSpaceKB();
+   else sd_free_space_KB += bytesErased/1024;
+
    #ifdef TEST_MODE_VERBOSE_ARCHIVE_DELETE
-   myLog.info("Deleted %u of %u archive directories", archiveFoldersDeleted, archiveFoldersFound );
+   myLog.info("Deleted %lu of %lu archive directories", archiveFoldersDeleted, archiveFoldersFound );
    #endif
 
-   return true;
+   return eraseSuccess;
 
 }
 
 
 
 
+/*=============================================>>>>>
+= Archive retention =
+===============================================>>>>>*/
+//Archives are freed oldest first until their total size is under budgetBytes
+//and the card has at least minFreeKB free.  Either limit can be 0 to disable it.
+void JazaSD::setArchiveRetention(uint32_t budgetBytes, uint32_t minFreeKB, uint16_t clustersPerTick){
+   retentionBudgetBytes = budgetBytes;
+   retentionMinFreeKB = minFreeKB;
+   //0 would never free anything
+   retentionClustersPerTick = clustersPerTick ? clustersPerTick : 1;
+}
+
+
+bool JazaSD::archiveRetentionNeeded(){
+   if(retentionBudgetBytes && archiveBytes > retentionBudgetBytes) return true;
+   if(retentionMinFreeKB){
+      //Use the volume's own count when it's known, sd_free_space_KB is only an estimate
+      //(an unknown count is seeded by the FAT scan serviceArchiveRetention() steps)
+      if(sd.vol()->freeClusterCountKnown()){
+         uint32_t freeClusters = sd.vol()->freeClusterCount();
+         if(freeClusters*(clusterRoundedSize(1)/1024) < retentionMinFreeKB) return true;
+      }
+      else if(sd_free_space_KB >= 0 && (uint32_t)sd_free_space_KB < retentionMinFreeKB) return true;
+   }
+   return false;
+}
+
+
+//Function that frees at most retentionClustersPerTick clusters of the oldest archive.
+//Call it from the main loop, it returns quickly when nothing needs freeing.
+bool JazaSD::serviceArchiveRetention(){
+   JAZASD_METRIC(JAZASD_OP_ARCHIVE_RETENTION);
+   if(!SD_INITIALIZED) return false;
+   if(!retentionBudgetBytes && !retentionMinFreeKB) return true;
+
+   asyncWriteBarrier();
+
+   //Seed an unknown free count a slice per tick, freeClusterCount() would walk the whole FAT
+   if(retentionMinFreeKB && !sd.vol()->freeClusterCountKnown()){
+      if(!FAT_SCAN_ACTIVE && !startFatScan()) return false;
+      if(serviceFatScan() == FatScanner::SCAN_ERROR) return false;
+   }
+
+   JazaArchiveRecord_t archiveRecord;
+   uint32_t clusterBytes = clusterRoundedSize(1);
+   uint32_t clustersFreed = 0;
+   char folderPathBuf[FOLDER_PATH_BUF_SIZE] = {0};
+   FatFile archiveDir;
+   FatFile workerFile;
+
+   //Total the archive sizes from the catalog (once, not every tick)
+   if(!archiveBytesKnown){
+      if(!catalogOpen()) return false;
+      archiveBytes = 0;
+      for(uint32_t index = 0; index < catalogNumRecords(); index++){
+         if(!catalogReadRecord(index, archiveRecord)){
+            catalogClose();
+            return false;
+         }
+         archiveBytes += archiveRecord.sizeBytes;
+      }
+      archiveBytesKnown = true;
+      #ifdef TEST_MODE_VERBOSE_ARCHIVE_DELETE
+      myLog.info("Archives use %lu bytes", archiveBytes);
+      #endif
+   }
+
+   if(!archiveRetentionNeeded()) return catalogClose();
+
+   if(file.isOpen()) if(!smartFileClose()) return false;
+   if(!catalogOpen()) return false;
+
+   //Always keep the newest archive as a restore point
+   if(catalogNumRecords() < 2) return catalogClose();
+   if(!catalogReadRecord(0, archiveRecord)){
+      catalogClose();
+      return false;
+   }
+   snprintf(folderPathBuf, FOLDER_PATH_BUF_SIZE, "%lu", (unsigned long)archiveRecord.stamp);
+
+   #ifdef TEST_MODE_VERBOSE_ARCHIVE_DELETE
+   myLog.info("Retention freeing archive %s (%lu bytes left)", folderPathBuf, (unsigned long)archiveRecord.sizeBytes);
+   #endif
+
+   //Free files one at a time until this tick's cluster budget is spent
+   if(archiveDir.open(sd.vwd(), folderPathBuf, O_READ)){
+      while(clustersFreed < retentionClustersPerTick){
+         if(!workerFile.openNext(&archiveDir, O_RDWR)){
+            //Archive folder is empty, remove it
+            if(archiveDir.getError() || !archiveDir.rmdir()){
+               printError(myLog, __LINE__, mes_sd_writeError);
+               catalogClose();
+               return false;
+            }
+            break;
+         }
+         uint32_t fileClusters = clusterRoundedSize(workerFile.fileSize())/clusterBytes;
+         uint32_t clustersLeft = retentionClustersPerTick - clustersFreed;
+         if(fileClusters > clustersLeft){
+            //Too big for this tick, free a slice off the end instead
+            if(
+               !workerFile.truncate(workerFile.fileSize() - clustersLeft*clusterBytes)
+               ||
+               !workerFile.close()
+            ){
+               printError(myLog, __LINE__, mes_sd_writeError);
+               catalogClose();
+               return false;
+            }
+            clustersFreed += clustersLeft;
+            break;
+         }
+         if(!workerFile.remove()){
+            printError(myLog, __LINE__, mes_sd_writeError);
+            catalogClose();
+            return false;
+         }
+         clustersFreed += fileClusters;
+      }
+   }
+   //Account for what was freed (the folder's own cluster once it's gone)
+   uint32_t bytesFreed = clustersFreed*clusterBytes;
+   if(!archiveDir.isOpen()) bytesFreed = archiveRecord.sizeBytes;
+   if(bytesFreed > archiveRecord.sizeBytes) bytesFreed = archiveRecord.sizeBytes;
+   archiveBytes -= (bytesFreed < archiveBytes) ? bytesFreed : archiveBytes;
+   sd_free_space_KB += bytesFreed/1024;
+
+   bool serviceSuccess = true;
+   if(!archiveDir.isOpen()){
+      //Archive is gone, drop it from the catalog
+      serviceSuccess = catalogRemoveRecords(0, 1);
+   }
+   else{
+      //Save progress so a reboot carries on where this left off
+      archiveRecord.sizeBytes -= bytesFreed;
+      archiveRecord.status = ARCHIVE_STATUS_DELETING;
+      serviceSuccess = catalogWriteRecord(0, archiveRecord);
+      archiveDir.close();
+   }
+   return catalogClose() && serviceSuccess;
+}
+
+
+
+
 bool JazaSD::restoreArchive(unsigned int targStamp){
+   JAZASD_METRIC(JAZASD_OP_RESTORE_ARCHIVE);
 
    if(!SD_INITIALIZED){
       #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY
@@ -1740,47 +2716,54 @@ bool JazaSD::restoreArchive(unsigned int targStamp){
 
 
    //Function that restores first archive after specified date
-   unsigned int closestStamp = 0XFFFFFFF;
-   unsigned int timeStamp = 0XFFFFFFFF;
+   unsigned int closestStamp = 0XFFFFFFFF;
+   JazaArchiveRecord_t archiveRecord;
+   uint32_t index = 0;
    //Close file if open
    #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_SUPER_HEAVY_AF
    myLog.info("smartFileClose() - L%u", __LINE__);
    #endif
    if(file.isOpen()) smartFileClose();
-   //Rewind root directory to first file
-   sd.vwd()->rewind();
-   //Loop through each file/folder in root directory
-   #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_SUPER_HEAVY_AF
-   myLog.info("file.openNext() - L%u", __LINE__);
-   #endif
-   while (file.openNext(sd.vwd(), O_READ)) {
-      #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_SUPER_HEAVY_AF
-      myLog.info("file.isDir() - L%u", __LINE__);
-      #endif
-      if (file.isDir()) {
-         //Get the directory name
-         #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_SUPER_HEAVY_AF
-         myLog.info("file.getName() - L%u", __LINE__);
+   //Binary search the catalog for the first archive after targStamp
+   if(!catalogOpen()) return false;
+   if(!catalogLowerBound(targStamp, index)){
+      catalogClose();
+      return false;
+   }
+   char archiveFilePath[50];
+   uint32_t numRecords = catalogNumRecords();
+   while(index < numRecords){
+      if(!catalogReadRecord(index, archiveRecord)) break;
+      //Skip an archive at exactly targStamp and any that were never finished (or are being freed)
+      if(
+         archiveRecord.stamp > targStamp &&
+         archiveRecord.status != ARCHIVE_STATUS_PENDING &&
+         archiveRecord.status != ARCHIVE_STATUS_DELETING
+      ){
+         snprintf(archiveFilePath, 50, "%lu", (unsigned long)archiveRecord.stamp);
+         if(sd.exists(archiveFilePath)){
+            closestStamp = archiveRecord.stamp;
+            break;
+         }
+         //Folder was deleted out from under the catalog, drop its record and keep looking
+         #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY
+         myLog.warn("Archive %s missing, removing it from the catalog", archiveFilePath);
          #endif
-         file.getName(filePathBuf, 50);
-         // Check if this directory has a name that is a unix timestamp
-         if(1 == sscanf(filePathBuf, "%u", &timeStamp)){
-            //Found an archive file
-            if(
-               (timeStamp > targStamp) &&
-               ((timeStamp - targStamp) < (closestStamp - targStamp))
-            ){
-               closestStamp = timeStamp;
-            }
+         if(!catalogRemoveRecords(index, 1)) break;
+         archiveBytesKnown = false;
+         numRecords--;
+         continue;
+      }
+      index++;
+   }
+   catalogClose();
 
-         }//end if directory is named after a unix timestamp
-      }// end if a directory
-      //Close the file
-      #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_SUPER_HEAVY_AF
-      myLog.info("smartFileClose() - L%u", __LINE__);
+   if(closestStamp == 0XFFFFFFFF){
+      #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY
+      myLog.info("No archive found after %u", targStamp);
       #endif
-      smartFileClose();
-   }//end loop of file
+      return false;
+   }
    //Restore the files in the target archive
    if(closestStamp == currentStamp){
       #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY
@@ -1796,7 +2779,6 @@ bool JazaSD::restoreArchive(unsigned int targStamp){
    );
    #endif
    //Copy each file we need from archive
-   char archiveFilePath[50];
    for(unsigned int count = 0; count < NUM_TYPES_JAZA_FILES; count++){
       //Compile archive file name
       snprintf(archiveFilePath, 50, "%u/%s", closestStamp, jazaFiles[count].name);
@@ -1861,6 +2843,7 @@ bool JazaSD::hasADelimiter(JAZA_FILES_t fileType, const char* targDelimiter){
 
 //Function that sets the file position to the beginning of the specified entry
 bool JazaSD::gotoEntry(JAZA_FILES_t fileType, uint32_t entryNum){
+   JAZASD_METRIC(JAZASD_OP_GOTO_ENTRY);
 
    #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY_AF
    myLog.info("gotoEntry()");
@@ -2004,6 +2987,7 @@ int JazaSD::getEntryStartByte(JAZA_FILES_t fileType, uint32_t entryNum){
 //into the sdBuf, and return a pointer to the sdBuf containing
 //the retrieved data
 char* JazaSD::getEntry(JAZA_FILES_t fileType, uint32_t entryNum){
+   JAZASD_METRIC(JAZASD_OP_GET_ENTRY);
    if(!SD_INITIALIZED) return NULL;
 
    static JAZA_FILES_t lastFileType = NUM_TYPES_JAZA_FILES;
@@ -2131,6 +3115,7 @@ char* JazaSD::getEntry(JAZA_FILES_t fileType, uint32_t entryNum){
 
 
 bool JazaSD::getEntryObjAt(JAZA_FILES_t fileType, uint32_t startPos, JazaEntry_t &targEntry){
+   JAZASD_METRIC(JAZASD_OP_GET_ENTRY_AT);
 
    #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY
    myLog.trace("Attempting to get entry startin at byte %lu from file \"%s\"", startPos, jazaFiles[fileType].name);
@@ -2142,7 +3127,7 @@ bool JazaSD::getEntryObjAt(JAZA_FILES_t fileType, uint32_t startPos, JazaEntry_t
    //Determine if start position is even in the file
    if(startPos >= file.fileSize()){
       myLog.error("Requested entry start pos not in file - line %d", __LINE__);
-      myLog.error("startPos = %lu but fileSize() = %lu", startPos, file.fileSize());
+      myLog.error("startPos = %lu but fileSize() = %lu", (unsigned long)startPos, (unsigned long)file.fileSize());
       return false;
    }
    targEntry.startPos = startPos;
@@ -2284,6 +3269,16 @@ bool JazaSD::fileEntry(JAZA_FILES_t fileType, const char* entry){
       return false;
    }
 
+   #if JAZASD_ENABLE_ASYNC_WRITES
+   if(ASYNC_WRITES_ENABLED && !onAsyncWorker()){
+      if(asyncEnqueue(JAZASD_CMD_FILE_ENTRY, fileType, 0, entry, false)) return true;
+      //Too long to queue, write it here once the queue has emptied
+      asyncWriteBarrier();
+   }
+   #endif
+   JAZASD_METRIC(JAZASD_OP_FILE_ENTRY);
+   JAZASD_METRIC_BYTES(strlen(entry));
+
    #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG
    myLog.trace("File following entry in \"%s\":", jazaFiles[fileType].name);
    myLog.trace("%s", entry );
@@ -2370,6 +3365,16 @@ bool JazaSD::overWriteBytes(JAZA_FILES_t fileType, uint32_t startByte, const cha
       return false;
    }
 
+   #if JAZASD_ENABLE_ASYNC_WRITES
+   if(ASYNC_WRITES_ENABLED && !onAsyncWorker()){
+      if(asyncEnqueue(JAZASD_CMD_OVERWRITE_BYTES, fileType, startByte, replacementBytes, false)) return true;
+      //Too long to queue, write it here once the queue has emptied
+      asyncWriteBarrier();
+   }
+   #endif
+   JAZASD_METRIC(JAZASD_OP_OVERWRITE_BYTES);
+   JAZASD_METRIC_BYTES(strlen(replacementBytes));
+
    #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY
    myLog.trace("overWriteBytes(\"%s\")", jazaFiles[fileType].name);
    #endif
@@ -2454,6 +3459,8 @@ bool JazaSD::overWriteBytes(JAZA_FILES_t fileType, uint32_t startByte, const cha
 = Function to read a set number of bytes from a file =
 ===============================================>>>>>*/
 char* JazaSD::readBytes(JAZA_FILES_t fileType, uint32_t startByte, uint32_t numReadBytes){
+   JAZASD_METRIC(JAZASD_OP_READ_BYTES);
+   JAZASD_METRIC_BYTES(numReadBytes);
    if(!SD_INITIALIZED) return NULL;
    //Sanity check on buffer size
    if(SD_BUF_SIZE < (numReadBytes - 1)){
@@ -2506,6 +3513,7 @@ char* JazaSD::readBytes(JAZA_FILES_t fileType, uint32_t startByte, uint32_t numR
 = Function to return the number of bytes in the file =
 ===============================================>>>>>*/
 uint32_t JazaSD::bytesInFile(JAZA_FILES_t fileType){
+   JAZASD_METRIC(JAZASD_OP_BYTES_IN_FILE);
    if(!SD_INITIALIZED) return 0;
 
    #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY
@@ -2532,6 +3540,7 @@ uint32_t JazaSD::bytesInFile(JAZA_FILES_t fileType){
 
 //Function that returns the number of entries inside fatfile corresponding to passed file type
 int JazaSD::numEntries(JAZA_FILES_t fileType){
+   JAZASD_METRIC(JAZASD_OP_NUM_ENTRIES);
    if(!SD_INITIALIZED) return -1;
 
    #ifdef TEST_MODE_VERBOSE_JAZASD_DEBUG_HEAVY_AF
@@ -2600,6 +3609,82 @@ int JazaSD::numEntries(JAZA_FILES_t fileType){
 
 
 
+/*=============================================>>>>>
+= Metrics Functions =
+===============================================>>>>>*/
+#if JAZASD_ENABLE_METRICS
+//Function that writes the stats of every call made so far into buf, e.g.
+//"fileEntry=12/3400/20/35/9:3,10:9;" is 12 calls, 3400 bytes, 20 block reads,
+//35 block writes, 3 calls of 512-1023us and 9 calls of 1024-2047us
+bool JazaSD::dumpStats(char* buf, size_t bufSize){
+   size_t bufPos = 0;
+   int numChars = 0;
+
+   if(!buf || !bufSize) return false;
+   buf[0] = 0;
+
+   for(unsigned int op = 0; op < NUM_TYPES_JAZASD_OP; op++){
+      JazaOpStats_t* stats = &jazaOpStats[op];
+      if(!stats->count) continue;
+
+      numChars = snprintf(&buf[bufPos], bufSize - bufPos, "%s=%lu/%lu/%lu/%lu/",
+         jazaOpNames[op], stats->count, stats->bytes, stats->blockReads, stats->blockWrites);
+      if(numChars < 0 || (size_t)numChars >= bufSize - bufPos){
+         printError(myLog, __LINE__, mes_buf_Small);
+         return false;
+      }
+      bufPos += numChars;
+
+      for(unsigned int bin = 0; bin < JAZASD_METRIC_BINS; bin++){
+         if(!stats->latency[bin]) continue;
+         numChars = snprintf(&buf[bufPos], bufSize - bufPos, "%u:%u,", bin, stats->latency[bin]);
+         if(numChars < 0 || (size_t)numChars >= bufSize - bufPos){
+            printError(myLog, __LINE__, mes_buf_Small);
+            return false;
+         }
+         bufPos += numChars;
+      }
+      //Swap the trailing comma for the end of this call's stats
+      buf[bufPos - 1] = ';';
+   }
+
+   #if USE_SD_YIELD_CALLBACK && !JAZASD_HOST_IMAGE
+   //Card waits as "wait=reason:count/us,...;" e.g. 1:40/31000 is 40
+   //programming waits that took 31000us in total
+   numChars = snprintf(&buf[bufPos], bufSize - bufPos, "wait=");
+   if(numChars < 0 || (size_t)numChars >= bufSize - bufPos){
+      printError(myLog, __LINE__, mes_buf_Small);
+      return false;
+   }
+   bufPos += numChars;
+   for(uint8_t reason = 0; reason < SdSpiCard::WAIT_REASON_COUNT; reason++){
+      numChars = snprintf(&buf[bufPos], bufSize - bufPos, "%u:%lu/%lu,", reason,
+         sd.card()->waitCount(reason), sd.card()->waitMicros(reason));
+      if(numChars < 0 || (size_t)numChars >= bufSize - bufPos){
+         printError(myLog, __LINE__, mes_buf_Small);
+         return false;
+      }
+      bufPos += numChars;
+   }
+   buf[bufPos - 1] = ';';
+   #endif
+   return true;
+}
+
+
+void JazaSD::resetStats(){
+   memset(jazaOpStats, 0, sizeof(jazaOpStats));
+   #if USE_SD_YIELD_CALLBACK && !JAZASD_HOST_IMAGE
+   sd.card()->resetWaitCounters();
+   #endif
+}
+#endif
+
+/*= End of Metrics Functions =*/
+/*=============================================<<<<<*/
+
+
+
 
 
 
@@ -27,6 +27,59 @@ the rest of our app to easily read and write data to the SD card in a csv format
 ===============================================>>>>>*/
 #define SD_BUF_SIZE 2049   //4 pages of SD memory (each page is 512 bytes)
 
+//Sorted catalog of archive folders so archive lookups don't walk the root directory
+#define ARCHIVE_CATALOG_NAME "archives.csv"
+#define ARCHIVE_CATALOG_RECORD_SIZE 25   //"%10lu,%10lu,%c\r\n"
+//Archive folder names are unix timestamps between 2011 and 2040
+#define ARCHIVE_STAMP_MIN 1300000000UL
+#define ARCHIVE_STAMP_MAX 2220000000UL
+//Archive status characters stored in the catalog
+#define ARCHIVE_STATUS_PENDING    'P'   //Archive is being written (or was interrupted)
+#define ARCHIVE_STATUS_COMPLETE   'C'   //Every jazaFile was copied into the archive
+#define ARCHIVE_STATUS_INCOMPLETE 'I'   //One or more jazaFiles could not be copied
+#define ARCHIVE_STATUS_DELETING   'D'   //Retention has started freeing this archive
+
+//Most clusters serviceArchiveRetention() frees per call (bigger files are truncated a slice at a time)
+#define ARCHIVE_RETENTION_CLUSTERS_PER_TICK 64
+
+//Default budget for each serviceFatScan() call
+#define FAT_SCAN_BLOCKS_PER_STEP 32
+#define FAT_SCAN_MICROS_PER_STEP 20000
+
+//Directory entries read per readDirEntries() call when walking a folder
+#define DIR_ENTRY_BATCH_SIZE 4
+
+//Set to 1 to allow fileEntry/replaceEntry/overWriteBytes to be queued to a worker thread
+#ifndef JAZASD_ENABLE_ASYNC_WRITES
+#define JAZASD_ENABLE_ASYNC_WRITES 0
+#endif
+#define JAZASD_QUEUE_SLOTS 8             //Number of writes that can be waiting at once
+#define JAZASD_QUEUE_DATA_SIZE 256       //Longer entries are written synchronously
+#define JAZASD_WORKER_STACK_SIZE 6144    //Stack for the SD worker thread
+#define JAZASD_ASYNC_WAIT_MS 10          //Longest wait on the worker between Particle_Process() calls
+
+//Set to 1 to record call counts, bytes, block I/O and latency of each JazaSD call (see dumpStats())
+//Block I/O counts also need USE_FAT_IO_COUNTERS set in SdFatConfig.h
+#ifndef JAZASD_ENABLE_METRICS
+#define JAZASD_ENABLE_METRICS 0
+#endif
+#define JAZASD_METRIC_BINS 16   //Latency bin n counts calls of 2^n to 2^(n+1)-1 us (last bin counts longer calls)
+
+//Set to 1 to mount a card image file in place of the SPI card (host builds, see host/Makefile)
+//Needs ENABLE_IMAGE_CARD_CLASS set in SdFatConfig.h
+#ifndef JAZASD_HOST_IMAGE
+#define JAZASD_HOST_IMAGE 0
+#endif
+#ifndef JAZASD_HOST_IMAGE_PATH
+#define JAZASD_HOST_IMAGE_PATH "jazasd.img"
+#endif
+
+//Set to 1 to use SdFatEX, which keeps multi-block transfers open between calls
+//Needs ENABLE_EXTENDED_TRANSFER_CLASS set in SdFatConfig.h, and the SPI bus to itself
+#ifndef JAZASD_USE_SD_EX
+#define JAZASD_USE_SD_EX 0
+#endif
+
 //Declare externally linked buffer for writing to the SD card
 extern char sdWriteBuf[SD_BUF_SIZE];
 
@@ -131,7 +184,7 @@ struct JazaEntry_t{
    unsigned int endPos = 0;
 
    void print(){
-      Serial.printlnf("JazaEntry_t:  entryNum = %u | startPos = %lu | endPos = %lu | text = \"%s\" ",
+      Serial.printlnf("JazaEntry_t:  entryNum = %u | startPos = %u | endPos = %u | text = \"%s\" ",
          entryNum, startPos, endPos, text);
    }
 
@@ -144,6 +197,25 @@ struct JazaEntry_t{
 };
 
 
+//Called on the SD worker thread when a queued write finishes, before writeDone() reports it
+typedef void (*JazaSDWriteCallback_t)(uint32_t seqNum, bool success);
+
+/*=============================================>>>>>
+= JazaArchiveRecord data structure =
+===============================================>>>>>*/
+//One fixed-width record of the archive catalog (see ARCHIVE_CATALOG_NAME)
+struct JazaArchiveRecord_t{
+   uint32_t stamp = 0;     //Unix timestamp (and directory name) of the archive
+   uint32_t sizeBytes = 0; //Bytes the archive occupies on the card (whole clusters)
+   char status = 0;        //One of the ARCHIVE_STATUS_xxx characters
+
+   void print(){
+      Serial.printlnf("JazaArchiveRecord_t:  stamp = %lu | sizeBytes = %lu | status = %c",
+         (unsigned long)stamp, (unsigned long)sizeBytes, status);
+   }
+};
+
+
 extern JazaFile_t jazaFiles[NUM_TYPES_JAZA_FILES];
 
 /*=============================================>>>>>
@@ -178,6 +250,11 @@ public:
    bool archiveFiles();
    bool restoreArchive(unsigned int targStamp);
    bool eraseArchives(unsigned int beforeDate);
+   bool rebuildArchiveCatalog();
+   void setArchiveRetention(uint32_t budgetBytes, uint32_t minFreeKB, uint16_t clustersPerTick = ARCHIVE_RETENTION_CLUSTERS_PER_TICK);
+   bool serviceArchiveRetention();
+   bool startFatScan();
+   int8_t serviceFatScan(uint16_t maxBlocks = FAT_SCAN_BLOCKS_PER_STEP, uint32_t maxMicros = FAT_SCAN_MICROS_PER_STEP);
    unsigned int freeSpaceKB();
 
    bool replaceFile(JAZA_FILES_t fileToReplace, JAZA_FILES_t replacementFile);
@@ -225,6 +302,33 @@ public:
 
    bool printHeaders(JAZA_FILES_t fileType);
 
+   /*=============================================>>>>>
+   = Metrics functions =
+   ===============================================>>>>>*/
+   #if JAZASD_ENABLE_METRICS
+   //Writes "name=count/bytes/blockReads/blockWrites/bin:calls,bin:calls;" for each call made
+   //then "wait=reason:count/us,...;" for SD card waits when USE_SD_YIELD_CALLBACK is set
+   bool dumpStats(char* buf, size_t bufSize);
+   void resetStats();
+   #endif
+
+   /*=============================================>>>>>
+   = Asynchronous write functions =
+   ===============================================>>>>>*/
+   #if JAZASD_ENABLE_ASYNC_WRITES
+   //While enabled, fileEntry/replaceEntry/overWriteBytes queue the write and
+   //return true straight away.  Anything else waits for queued writes first,
+   //so pointers returned by reads are only good until the next queued write.
+   bool setAsyncWrites(bool enable, JazaSDWriteCallback_t callback = NULL);
+   bool asyncWritesEnabled();
+   //Sequence number of the most recently queued write
+   uint32_t lastQueuedWrite();
+   bool writeDone(uint32_t seqNum);
+   //Wait for every queued write (returns false if any failed since the last flush)
+   //Card recovery for a failed queued write runs here, on the calling thread
+   bool flush();
+   #endif
+
 
    /*=============================================>>>>>
    = Publish backlog functions =
@@ -247,12 +351,24 @@ public:
 private:
    bool ready; //True if all systems check out when initializing jazaSD
 
+   //Archive retention settings (see setArchiveRetention())
+   uint32_t retentionBudgetBytes = 0;
+   uint32_t retentionMinFreeKB = 0;
+   uint16_t retentionClustersPerTick = ARCHIVE_RETENTION_CLUSTERS_PER_TICK;
+   //Running total of archive sizes in the catalog (recounted when archiveBytesKnown is false)
+   uint32_t archiveBytes = 0;
+   bool archiveBytesKnown = false;
+
+   bool archiveRetentionNeeded();
+
 };
 
 //Externally linked global utiliity declaration
 extern JazaSD jazaSD;
 // extern File file;
 extern SdFile file;
+//Time-sliced FAT scan driven by jazaSD.serviceFatScan() (results are read from here)
+extern FatScanner fatScanner;
 
 //Callback function that the SD fat library will use for keeping records
 //such as date created, date modified, etc etc.
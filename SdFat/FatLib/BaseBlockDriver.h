@@ -76,5 +76,43 @@ class BaseBlockDriver {
    */
   virtual bool writeBlocks(uint32_t block, const uint8_t* src, size_t nb) = 0;
 #endif  // USE_MULTI_BLOCK_IO
+#if USE_ASYNC_BLOCK_IO
+  /**
+   * Start writing a 512 byte block.  The write may still be in progress
+   * on return so call poll() to find when it is done.
+   *
+   * \param[in] block Logical block to be written.
+   * \param[in] src Pointer to the location of the data to be written.
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  virtual bool writeBlockStart(uint32_t block, const uint8_t* src) {
+    return writeBlock(block, src);
+  }
+#if USE_MULTI_BLOCK_IO
+  /**
+   * Start reading multiple 512 byte blocks.  The data is not valid until
+   * poll() returns one.  No other driver call may be made before then.
+   *
+   * \param[in] block Logical block to be read.
+   * \param[in] nb Number of blocks to be read.
+   * \param[out] dst Pointer to the location that will receive the data.
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  virtual bool readBlocksStart(uint32_t block, uint8_t* dst, size_t nb) {
+    return readBlocks(block, dst, nb);
+  }
+#endif  // USE_MULTI_BLOCK_IO
+  /**
+   * Advance a started operation without waiting.
+   *
+   * \return one if no operation is in progress, zero if the operation is
+   * not done, or minus one for an error.
+   */
+  virtual int8_t poll() {
+    return 1;
+  }
+#endif  // USE_ASYNC_BLOCK_IO
 };
 #endif  // BaseBlockDriver_h
@@ -93,7 +93,7 @@ fail:
 }
 //------------------------------------------------------------------------------
 bool FatFile::close() {
-  bool rtn = sync();
+  bool rtn = syncDirEntry();
   m_attr = FILE_ATTR_CLOSED;
   return rtn;
 }
@@ -155,7 +155,7 @@ bool FatFile::createContiguous(FatFile* dirFile,
 
   // insure sync() will update dir entry
   m_flags |= F_FILE_DIR_DIRTY;
-  return sync();
+  return syncDirEntry();
 
 fail:
   return false;
@@ -164,7 +164,7 @@ fail:
 bool FatFile::dirEntry(dir_t* dst) {
   dir_t* dir;
   // Make sure fields on device are correct.
-  if (!sync()) {
+  if (!syncDirEntry()) {
     DBG_FAIL_MACRO;
     goto fail;
   }
@@ -203,6 +203,22 @@ uint8_t FatFile::dirName(const dir_t* dir, char* name) {
   name[j] = 0;
   return j;
 }
+#if FAT_DIR_ENTRY_NAME_DIM
+//------------------------------------------------------------------------------
+void FatFile::dirEntryCopy(const dir_t* dir, uint16_t index,
+                           FatDirEntry_t* entry) {
+  entry->fileSize = dir->fileSize;
+  entry->firstCluster = (uint32_t)dir->firstClusterHigh << 16
+                        | dir->firstClusterLow;
+  entry->createDate = dir->creationDate;
+  entry->createTime = dir->creationTime;
+  entry->modifyDate = dir->lastWriteDate;
+  entry->modifyTime = dir->lastWriteTime;
+  entry->accessDate = dir->lastAccessDate;
+  entry->dirIndex = index;
+  entry->attributes = dir->attributes & DIR_ATT_DEFINED_BITS;
+}
+#endif  // FAT_DIR_ENTRY_NAME_DIM
 
 //------------------------------------------------------------------------------
 uint32_t FatFile::dirSize() {
@@ -488,7 +504,7 @@ fail:
 bool FatFile::openCachedEntry(FatFile* dirFile, uint16_t dirIndex,
                               uint8_t oflag, uint8_t lfnOrd) {
   uint32_t firstCluster;
-  memset(this, 0, sizeof(FatFile));
+  clearState();
   // location of entry in cache
   m_vol = dirFile->m_vol;
   m_dirIndex = dirIndex;
@@ -527,11 +543,14 @@ bool FatFile::openCachedEntry(FatFile* dirFile, uint16_t dirIndex,
       goto fail;
     }
     // need to update directory entry
-    m_flags |= F_FILE_DIR_DIRTY;
+    m_flags |= F_FILE_DIR_DIRTY | F_FILE_DIR_FORCE;
   } else {
     m_firstCluster = firstCluster;
     m_fileSize = dir->fileSize;
   }
+#if FAT_DIR_SYNC_LAG
+  m_dirFileSize = m_fileSize;
+#endif  // FAT_DIR_SYNC_LAG
   if ((oflag & O_AT_END) && !seekSet(m_fileSize)) {
     DBG_FAIL_MACRO;
     goto fail;
@@ -632,7 +651,7 @@ bool FatFile::openParent(FatFile* dirFile) {
       goto fail;
     }
   } else {
-    memset(&dotdot, 0, sizeof(FatFile));
+    dotdot.clearState();
     dotdot.m_attr = FILE_ATTR_SUBDIR;
     dotdot.m_flags = O_READ;
     dotdot.m_vol = dirFile->m_vol;
@@ -661,7 +680,7 @@ bool FatFile::openRoot(FatVolume* vol) {
     DBG_FAIL_MACRO;
     goto fail;
   }
-  memset(this, 0, sizeof(FatFile));
+  clearState();
 
   m_vol = vol;
   switch (vol->fatType()) {
@@ -755,12 +774,38 @@ int FatFile::read(void* buf, size_t nbyte) {
       }
       block = m_vol->clusterFirstBlock(m_curCluster) + blockOfCluster;
     }
-    if (offset != 0 || toRead < 512 || block == m_vol->cacheBlockNumber()) {
+    if (offset != 0 || toRead < 512 || m_vol->cacheIsCached(block)) {
       // amount to be read from current block
       n = 512 - offset;
       if (n > toRead) {
         n = toRead;
       }
+#if FAT_READ_AHEAD_BLOCKS
+      uint8_t* src = 0;
+      // Directory reads must load the cache for readDirCache().
+      if (isFile() && !m_vol->cacheIsCached(block)) {
+        // read ahead at most to the end of this cluster and file
+        size_t nb = m_vol->blocksPerCluster() - blockOfCluster;
+        uint32_t left = ((m_fileSize - 1) >> 9) - (m_curPosition >> 9) + 1;
+        if (nb > left) {
+          nb = left;
+        }
+        if (m_vol->readAhead(block, nb, &src) < 0) {
+          DBG_FAIL_MACRO;
+          goto fail;
+        }
+      }
+      if (!src) {
+        // read block to cache
+        pc = m_vol->cacheFetchData(block, FatCache::CACHE_FOR_READ);
+        if (!pc) {
+          DBG_FAIL_MACRO;
+          goto fail;
+        }
+        src = pc->data;
+      }
+      memcpy(dst, src + offset, n);
+#else  // FAT_READ_AHEAD_BLOCKS
       // read block to cache and copy data to caller
       pc = m_vol->cacheFetchData(block, FatCache::CACHE_FOR_READ);
       if (!pc) {
@@ -769,6 +814,7 @@ int FatFile::read(void* buf, size_t nbyte) {
       }
       uint8_t* src = pc->data + offset;
       memcpy(dst, src, n);
+#endif  // FAT_READ_AHEAD_BLOCKS
 #if USE_MULTI_BLOCK_IO
     } else if (toRead >= 1024) {
       size_t nb = toRead >> 9;
@@ -779,13 +825,10 @@ int FatFile::read(void* buf, size_t nbyte) {
         }
       }
       n = 512*nb;
-      if (block <= m_vol->cacheBlockNumber()
-          && block < (m_vol->cacheBlockNumber() + nb)) {
-        // flush cache if a block is in the cache
-        if (!m_vol->cacheSyncData()) {
-          DBG_FAIL_MACRO;
-          goto fail;
-        }
+      // flush cached blocks in the range
+      if (!m_vol->cacheSyncData(block, nb)) {
+        DBG_FAIL_MACRO;
+        goto fail;
       }
       if (!m_vol->readBlocks(block, dst, nb)) {
         DBG_FAIL_MACRO;
@@ -899,7 +942,7 @@ bool FatFile::rename(FatFile* dirFile, const char* newPath) {
     goto fail;
   }
   // sync() and cache directory entry
-  sync();
+  syncDirEntry();
   oldFile = *this;
   dir = cacheDirEntry(FatCache::CACHE_FOR_READ);
   if (!dir) {
@@ -1027,6 +1070,21 @@ fail:
 bool FatFile::rmRfStar() {
   uint16_t index;
   FatFile f;
+#if FAT_FREE_BATCH_SIZE
+  if (!m_vol->m_freeBatchHold) {
+    // Free clusters in sorted batches and sync once for the whole tree.
+    m_vol->m_freeBatchHold = true;
+    bool rtn = rmRfStar();
+    if (!m_vol->freeBatchFlush()) {
+      rtn = false;
+    }
+    m_vol->m_freeBatchHold = false;
+    if (!m_vol->cacheSync()) {
+      rtn = false;
+    }
+    return rtn;
+  }
+#endif  // FAT_FREE_BATCH_SIZE
   if (!isDir()) {
     DBG_FAIL_MACRO;
     goto fail;
@@ -1136,6 +1194,32 @@ bool FatFile::seekSet(uint32_t pos) {
   if (nNew < nCur || m_curPosition == 0) {
     // must follow chain from first cluster
     m_curCluster = isRoot32() ? m_vol->rootDirStart() : m_firstCluster;
+#if USE_FAT_EXTENT_CACHE
+    nCur = 0;
+  }
+  if (extentFind(nNew, &nCur)) {
+    goto done;
+  }
+  {
+    // record runs found while following the chain
+    uint32_t runIndex = nCur;
+    uint32_t runCluster = m_curCluster;
+    for (; nCur < nNew; nCur++) {
+      uint32_t next;
+      if (m_vol->fatGet(m_curCluster, &next) <= 0) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      if (next != m_curCluster + 1) {
+        extentAdd(runIndex, runCluster, nCur + 1 - runIndex);
+        runIndex = nCur + 1;
+        runCluster = next;
+      }
+      m_curCluster = next;
+    }
+    extentAdd(runIndex, runCluster, nCur + 1 - runIndex);
+  }
+#else  // USE_FAT_EXTENT_CACHE
   } else {
     // advance from curPosition
     nNew -= nCur;
@@ -1146,6 +1230,7 @@ bool FatFile::seekSet(uint32_t pos) {
       goto fail;
     }
   }
+#endif  // USE_FAT_EXTENT_CACHE
 
 done:
   m_curPosition = pos;
@@ -1155,6 +1240,60 @@ fail:
   m_curCluster = tmp;
   return false;
 }
+#if USE_FAT_EXTENT_CACHE
+//------------------------------------------------------------------------------
+void FatFile::extentAdd(uint32_t index, uint32_t cluster, uint32_t count) {
+  FatExtent_t* ext;
+  for (uint8_t i = 0; i < FAT_EXTENT_CACHE_SIZE; i++) {
+    ext = &m_extent[i];
+    if (!ext->count) {
+      continue;
+    }
+    // Already known or continues an existing run.
+    if (index >= ext->index && (index - ext->index) < ext->count &&
+        cluster - ext->cluster == index - ext->index) {
+      if ((index + count) > (ext->index + ext->count)) {
+        ext->count = index + count - ext->index;
+      }
+      return;
+    }
+    if (index == ext->index + ext->count &&
+        cluster == ext->cluster + ext->count) {
+      ext->count += count;
+      return;
+    }
+  }
+  ext = &m_extent[m_extentNext];
+  if (++m_extentNext >= FAT_EXTENT_CACHE_SIZE) {
+    m_extentNext = 0;
+  }
+  ext->index = index;
+  ext->cluster = cluster;
+  ext->count = count;
+}
+//------------------------------------------------------------------------------
+// Set m_curCluster for cluster index and return true if it is in a run.
+// Otherwise advance start and m_curCluster to the nearest known cluster
+// before index and return false.
+bool FatFile::extentFind(uint32_t index, uint32_t* start) {
+  for (uint8_t i = 0; i < FAT_EXTENT_CACHE_SIZE; i++) {
+    FatExtent_t* ext = &m_extent[i];
+    if (!ext->count || index < ext->index) {
+      continue;
+    }
+    uint32_t n = index - ext->index;
+    if (n < ext->count) {
+      m_curCluster = ext->cluster + n;
+      return true;
+    }
+    if ((ext->index + ext->count - 1) > *start) {
+      *start = ext->index + ext->count - 1;
+      m_curCluster = ext->cluster + ext->count - 1;
+    }
+  }
+  return false;
+}
+#endif  // USE_FAT_EXTENT_CACHE
 //------------------------------------------------------------------------------
 void FatFile::setpos(FatPos_t* pos) {
   m_curPosition = pos->position;
@@ -1165,7 +1304,7 @@ bool FatFile::sync() {
   if (!isOpen()) {
     return true;
   }
-  if (m_flags & F_FILE_DIR_DIRTY) {
+  if ((m_flags & F_FILE_DIR_DIRTY) && !dirSyncDeferred()) {
     dir_t* dir = cacheDirEntry(FatCache::CACHE_FOR_WRITE);
     // check for deleted by another open file object
     if (!dir || dir->name[0] == DIR_NAME_DELETED) {
@@ -1175,6 +1314,9 @@ bool FatFile::sync() {
     // do not set filesize for dir files
     if (isFile()) {
       dir->fileSize = m_fileSize;
+#if FAT_DIR_SYNC_LAG
+      m_dirFileSize = m_fileSize;
+#endif  // FAT_DIR_SYNC_LAG
     }
 
     // update first cluster fields
@@ -1183,11 +1325,15 @@ bool FatFile::sync() {
 
     // set modify time if user supplied a callback date/time function
     if (m_dateTime) {
-      m_dateTime(&dir->lastWriteDate, &dir->lastWriteTime);
-      dir->lastAccessDate = dir->lastWriteDate;
+      // dir is packed, so don't hand out pointers to its members
+      uint16_t date, time;
+      m_dateTime(&date, &time);
+      dir->lastWriteDate = date;
+      dir->lastWriteTime = time;
+      dir->lastAccessDate = date;
     }
     // clear directory dirty
-    m_flags &= ~F_FILE_DIR_DIRTY;
+    m_flags &= ~(F_FILE_DIR_DIRTY | F_FILE_DIR_FORCE);
   }
   if (m_vol->cacheSync()) {
     return true;
@@ -1209,7 +1355,7 @@ bool FatFile::timestamp(FatFile* file) {
     goto fail;
   }
   // update directory fields
-  if (!sync()) {
+  if (!syncDirEntry()) {
     DBG_FAIL_MACRO;
     goto fail;
   }
@@ -1253,7 +1399,7 @@ bool FatFile::timestamp(uint8_t flags, uint16_t year, uint8_t month,
     goto fail;
   }
   // update directory entry
-  if (!sync()) {
+  if (!syncDirEntry()) {
     DBG_FAIL_MACRO;
     goto fail;
   }
@@ -1308,6 +1454,9 @@ bool FatFile::truncate(uint32_t length) {
     DBG_FAIL_MACRO;
     goto fail;
   }
+#if USE_FAT_EXTENT_CACHE
+  extentInvalidate();
+#endif  // USE_FAT_EXTENT_CACHE
   if (length == 0) {
     // free all clusters
     if (!m_vol->freeChain(m_firstCluster)) {
@@ -1340,7 +1489,7 @@ bool FatFile::truncate(uint32_t length) {
   // need to update directory entry
   m_flags |= F_FILE_DIR_DIRTY;
 
-  if (!sync()) {
+  if (!syncDirEntry()) {
     DBG_FAIL_MACRO;
     goto fail;
   }
@@ -1350,6 +1499,88 @@ bool FatFile::truncate(uint32_t length) {
 fail:
   return false;
 }
+#if FAT_DIR_SYNC_LAG
+//------------------------------------------------------------------------------
+bool FatFile::recoverSize() {
+  uint32_t size = m_fileSize;
+  uint32_t pos = m_curPosition;
+  uint32_t clusterMask = (512UL << m_vol->clusterSizeShift()) - 1;
+  uint32_t cluster;
+  uint32_t next;
+  uint32_t end;
+  uint8_t buf[32];
+  int8_t fg;
+  int i;
+  int n;
+
+  if (!isFile() || !(m_flags & O_WRITE)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  // No data past the end if there are no clusters.
+  if (m_firstCluster == 0) {
+    return true;
+  }
+  if (!seekSet(size)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  // End of the cluster that holds the end of data.
+  cluster = size ? m_curCluster : m_firstCluster;
+  end = size ? ((size - 1) | clusterMask) + 1 : clusterMask + 1;
+
+  // Follow the chain until the scan range is covered.
+  while (end - size < FAT_DIR_SYNC_LAG) {
+    fg = m_vol->fatGet(cluster, &next);
+    if (fg < 0) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if (fg == 0) {
+      break;
+    }
+    cluster = next;
+    end += clusterMask + 1;
+  }
+  if (end - size > FAT_DIR_SYNC_LAG) {
+    end = size + FAT_DIR_SYNC_LAG;
+  }
+  // Let read() scan past the old size for the first byte that isn't text.
+  m_fileSize = end;
+  do {
+    n = read(buf, sizeof(buf));
+    if (n < 0) {
+      m_fileSize = size;
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    for (i = 0; i < n; i++) {
+      if (buf[i] < 0X20 && buf[i] != '\t' && buf[i] != '\r' &&
+          buf[i] != '\n') {
+        break;
+      }
+    }
+  } while (n > 0 && i == n);
+
+  // Only a zero byte marks the end of data written by sync().
+  if (i < n && buf[i] == 0) {
+    m_fileSize = m_curPosition - n + i;
+  } else {
+    m_fileSize = size;
+  }
+  if (m_fileSize != size) {
+    m_flags |= F_FILE_DIR_DIRTY;
+    if (!syncDirEntry()) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  }
+  return seekSet(pos);
+
+fail:
+  return false;
+}
+#endif  // FAT_DIR_SYNC_LAG
 //------------------------------------------------------------------------------
 int FatFile::write(const void* buf, size_t nbyte) {
   // convert void* to uint8_t*  -  must be before goto statements
@@ -1402,6 +1633,7 @@ int FatFile::write(const void* buf, size_t nbyte) {
             goto fail;
           }
           m_firstCluster = m_curCluster;
+          m_flags |= F_FILE_DIR_FORCE;
         } else {
           m_curCluster = m_firstCluster;
         }
@@ -1433,9 +1665,15 @@ int FatFile::write(const void* buf, size_t nbyte) {
       }
       uint8_t* dst = pc->data + blockOffset;
       memcpy(dst, src, n);
+#if FAT_DIR_SYNC_LAG
+      if (m_curPosition + n >= m_fileSize) {
+        // Zero past the end of data so recoverSize() can find it.
+        memset(dst + n, 0, 512 - blockOffset - n);
+      }
+#endif  // FAT_DIR_SYNC_LAG
       if (512 == (n + blockOffset)) {
         // Force write if block is full - improves large writes.
-        if (!m_vol->cacheSyncData()) {
+        if (!m_vol->cacheSyncData(block, 1)) {
           DBG_FAIL_MACRO;
           goto fail;
         }
@@ -1449,11 +1687,8 @@ int FatFile::write(const void* buf, size_t nbyte) {
         nBlock = maxBlocks;
       }
       n = 512*nBlock;
-      if (block <= m_vol->cacheBlockNumber()
-          && block < (m_vol->cacheBlockNumber() + nBlock)) {
-        // invalidate cache if block is in cache
-        m_vol->cacheInvalidate();
-      }
+      // invalidate cached blocks in the range
+      m_vol->cacheInvalidate(block, nBlock);
       if (!m_vol->writeBlocks(block, src, nBlock)) {
         DBG_FAIL_MACRO;
         goto fail;
@@ -1462,9 +1697,7 @@ int FatFile::write(const void* buf, size_t nbyte) {
     } else {
       // use single block write command
       n = 512;
-      if (m_vol->cacheBlockNumber() == block) {
-        m_vol->cacheInvalidate();
-      }
+      m_vol->cacheInvalidate(block, 1);
       if (!m_vol->writeBlock(block, src)) {
         DBG_FAIL_MACRO;
         goto fail;
@@ -102,6 +102,48 @@ const uint8_t FNAME_FLAG_NEED_LFN =
 const uint8_t FNAME_FLAG_LC_BASE = DIR_NT_LC_BASE;
 /** Filename extension is all lower case. */
 const uint8_t FNAME_FLAG_LC_EXT = DIR_NT_LC_EXT;
+#if FAT_DIR_ENTRY_NAME_DIM
+#if FAT_DIR_ENTRY_NAME_DIM < 13
+#error FAT_DIR_ENTRY_NAME_DIM must be at least 13 to hold a short name
+#endif  // FAT_DIR_ENTRY_NAME_DIM < 13
+//------------------------------------------------------------------------------
+/**
+ * \struct FatDirEntry_t
+ * \brief Directory entry returned by FatFile::readDirEntries().
+ */
+struct FatDirEntry_t {
+  /** Long file name, or short file name if there is no LFN. */
+  char name[FAT_DIR_ENTRY_NAME_DIM];
+  /** Size of the file in bytes. */
+  uint32_t fileSize;
+  /** First cluster of the file, zero if no data. */
+  uint32_t firstCluster;
+  /** Creation date in FAT format. */
+  uint16_t createDate;
+  /** Creation time in FAT format. */
+  uint16_t createTime;
+  /** Last write date in FAT format. */
+  uint16_t modifyDate;
+  /** Last write time in FAT format. */
+  uint16_t modifyTime;
+  /** Last access date in FAT format. */
+  uint16_t accessDate;
+  /** Index of the short name entry, use with FatFile::open(dirFile, index,
+   *  oflag) to open the file. */
+  uint16_t dirIndex;
+  /** FAT directory attributes. */
+  uint8_t attributes;
+  /** \return True if the entry is a subdirectory. */
+  bool isDir() const {
+    return attributes & DIR_ATT_DIRECTORY;
+  }
+};
+/**
+ * Filter for FatFile::readDirEntries().  Return 1 to keep the entry,
+ * 0 to skip it or -1 to stop without keeping it.
+ */
+typedef int8_t (*FatDirEntryFilter_t)(const FatDirEntry_t* entry, void* arg);
+#endif  // FAT_DIR_ENTRY_NAME_DIM
 //==============================================================================
 /**
  * \class FatFile
@@ -711,6 +753,26 @@ class FatFile {
    * a directory file or an I/O error occurred.
    */
   int8_t readDir(dir_t* dir);
+#if FAT_DIR_ENTRY_NAME_DIM
+  /** Read directory entries without opening the files.
+   *
+   * Entries are read from the current position so a directory can be
+   * walked in batches.  Deleted entries, '.', '..', the volume label and
+   * LFN entries are skipped.
+   *
+   * \param[out] entry Array that receives the entries.
+   * \param[in] count Number of elements in \a entry.
+   * \param[in] filter Called for each entry, see FatDirEntryFilter_t.
+   *                   Zero keeps all entries.
+   * \param[in] arg Passed to \a filter.
+   *
+   * \return The number of entries stored.  A value less than \a count,
+   * including zero, is returned at the end of the directory or when
+   * \a filter stops the walk.  If an error occurs -1 is returned.
+   */
+  int readDirEntries(FatDirEntry_t* entry, uint16_t count,
+                     FatDirEntryFilter_t filter = 0, void* arg = 0);
+#endif  // FAT_DIR_ENTRY_NAME_DIM
   /** Remove a file.
    *
    * The directory entry and all data for the file are deleted.
@@ -827,6 +889,10 @@ class FatFile {
   /** The sync() call causes all modified data and directory fields
    * to be written to the storage device.
    *
+   * If FAT_DIR_SYNC_LAG is nonzero the size and modify time in the
+   * directory entry of a growing file may lag the data by less than
+   * FAT_DIR_SYNC_LAG bytes.  close() always updates the entry.
+   *
    * \return The value true is returned for success and
    * the value false is returned for failure.
    */
@@ -896,6 +962,20 @@ class FatFile {
    * the value false is returned for failure.
    */
   bool truncate(uint32_t length);
+#if FAT_DIR_SYNC_LAG
+  /** Recover the size of a text file after a reset left its directory
+   * entry behind the data.
+   *
+   * Up to FAT_DIR_SYNC_LAG bytes past the current size are scanned for
+   * the first zero byte, which marks the end of data written by sync().
+   * The size is only changed if a zero byte is found in the file's
+   * clusters.  Files that may contain zero bytes must not be recovered.
+   *
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool recoverSize();
+#endif  // FAT_DIR_SYNC_LAG
   /** \return FatVolume that contains this file. */
   FatVolume* volume() const {
     return m_vol;
@@ -967,19 +1047,66 @@ class FatFile {
   dir_t* cacheDirEntry(uint8_t action);
   static uint8_t lfnChecksum(uint8_t* name);
   bool lfnUniqueSfn(fname_t* fname);
+#if FAT_DIR_ENTRY_NAME_DIM
+  static void dirEntryCopy(const dir_t* dir, uint16_t index,
+                           FatDirEntry_t* entry);
+#endif  // FAT_DIR_ENTRY_NAME_DIM
   bool openCluster(FatFile* file);
+#if FAT_DIR_SYNC_LAG
+  // True if sync() can leave the directory entry behind.  The end of data
+  // must not be block aligned so recoverSize() finds the zeroed tail.
+  bool dirSyncDeferred() {
+    return isFile() && !(m_flags & F_FILE_DIR_FORCE) &&
+           m_fileSize >= m_dirFileSize &&
+           m_fileSize - m_dirFileSize < FAT_DIR_SYNC_LAG &&
+           (m_fileSize == m_dirFileSize || (m_fileSize & 0X1FF));
+  }
+#else  // FAT_DIR_SYNC_LAG
+  bool dirSyncDeferred() {
+    return false;
+  }
+#endif  // FAT_DIR_SYNC_LAG
+  // sync() that always writes a dirty directory entry.
+  bool syncDirEntry() {
+    m_flags |= F_FILE_DIR_FORCE;
+    return sync();
+  }
   static bool parsePathName(const char* str, fname_t* fname, const char** ptr);
   bool mkdir(FatFile* parent, fname_t* fname);
+#if FAT_NAME_CACHE_SIZE
+  bool nameCacheCheck(fname_t* fname, uint16_t index, uint8_t lfnOrd);
+#endif  // FAT_NAME_CACHE_SIZE
   bool open(FatFile* dirFile, fname_t* fname, uint8_t oflag);
   bool openCachedEntry(FatFile* dirFile, uint16_t cacheIndex, uint8_t oflag,
                        uint8_t lfnOrd);
   bool readLBN(uint32_t* lbn);
   dir_t* readDirCache(bool skipReadOk = false);
   bool setDirSize();
+  // Zero the file state.  sizeof(FatFile) would also cover tail padding,
+  // which a host compiler with 64-bit pointers may give to members of a
+  // derived class such as StdioStream.
+  void clearState() {
+#if USE_FAT_EXTENT_CACHE
+    memset(this, 0, offsetof(FatFile, m_extent) + sizeof(m_extent));
+#elif FAT_DIR_SYNC_LAG
+    memset(this, 0, offsetof(FatFile, m_dirFileSize) + sizeof(m_dirFileSize));
+#else  // USE_FAT_EXTENT_CACHE
+    memset(this, 0, offsetof(FatFile, m_firstCluster) + sizeof(m_firstCluster));
+#endif  // USE_FAT_EXTENT_CACHE
+  }
+#if USE_FAT_EXTENT_CACHE
+  void extentAdd(uint32_t index, uint32_t cluster, uint32_t count);
+  bool extentFind(uint32_t index, uint32_t* start);
+  void extentInvalidate() {
+    memset(m_extent, 0, sizeof(m_extent));
+  }
+#endif  // USE_FAT_EXTENT_CACHE
 
   // bits defined in m_flags
   // should be 0X0F
   static const uint8_t F_OFLAG = (O_ACCMODE | O_APPEND | O_SYNC);
+  // directory entry can't lag, see FAT_DIR_SYNC_LAG
+  static const uint8_t F_FILE_DIR_FORCE = 0X40;
   // sync of directory entry required
   static const uint8_t F_FILE_DIR_DIRTY = 0X80;
 
@@ -1002,5 +1129,18 @@ class FatFile {
   uint32_t   m_dirBlock;         // block for this files directory entry
   uint32_t   m_fileSize;         // file size in bytes
   uint32_t   m_firstCluster;     // first cluster of file
+#if FAT_DIR_SYNC_LAG
+  uint32_t   m_dirFileSize;      // file size in directory entry
+#endif  // FAT_DIR_SYNC_LAG
+#if USE_FAT_EXTENT_CACHE
+  // Run of contiguous clusters starting at file cluster index.
+  struct FatExtent_t {
+    uint32_t index;
+    uint32_t cluster;
+    uint32_t count;
+  };
+  uint8_t    m_extentNext;       // next extent to replace
+  FatExtent_t m_extent[FAT_EXTENT_CACHE_SIZE];
+#endif  // USE_FAT_EXTENT_CACHE
 };
 #endif  // FatFile_h
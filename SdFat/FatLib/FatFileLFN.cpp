@@ -48,6 +48,17 @@ static uint16_t Bernstein(uint16_t hash, const char *str, size_t len) {
   }
   return hash;
 }
+#if FAT_NAME_CACHE_SIZE
+//------------------------------------------------------------------------------
+// Bernstein hash of the case folded name for the name cache.
+static uint16_t lfnNameHash(fname_t* fname) {
+  uint16_t hash = 0;
+  for (size_t i = 0; i < fname->len; i++) {
+    hash = ((hash << 5) + hash) ^ lfnToLower(fname->lfn[i]);
+  }
+  return hash;
+}
+#endif  // FAT_NAME_CACHE_SIZE
 //------------------------------------------------------------------------------
 /**
  * Fetch a 16-bit long file name character.
@@ -166,12 +177,86 @@ fail:
   name[0] = 0;
   return false;
 }
+#if FAT_DIR_ENTRY_NAME_DIM
+//------------------------------------------------------------------------------
+int FatFile::readDirEntries(FatDirEntry_t* entry, uint16_t count,
+                            FatDirEntryFilter_t filter, void* arg) {
+  uint8_t chksum = 0;
+  uint8_t ord = 0;
+  uint16_t index;
+  uint16_t n = 0;
+  int8_t keep;
+  dir_t* dir;
+  ldir_t* ldir;
+
+  if (!isDir() || (curPosition() & 0X1F)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  while (n < count) {
+    index = curPosition()/32;
+    dir = readDirCache();
+    if (!dir) {
+      if (getError()) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      break;
+    }
+    if (dir->name[0] == DIR_NAME_FREE) {
+      // Leave the end marker for the next call.
+      if (!seekCur(-32)) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      break;
+    }
+    if (dir->name[0] == '.' || dir->name[0] == DIR_NAME_DELETED) {
+      ord = 0;
+    } else if (DIR_IS_FILE_OR_SUBDIR(dir)) {
+      dirEntryCopy(dir, index, &entry[n]);
+      // Use the SFN unless the LFN is complete and belongs to this entry.
+      if (ord != 1 || chksum != lfnChecksum(dir->name)) {
+        dirName(dir, entry[n].name);
+      }
+      ord = 0;
+      keep = filter ? filter(&entry[n], arg) : 1;
+      if (keep < 0) {
+        break;
+      }
+      if (keep) {
+        n++;
+      }
+    } else if (DIR_IS_LONG_NAME(dir)) {
+      ldir = reinterpret_cast<ldir_t*>(dir);
+      if (ldir->ord & LDIR_ORD_LAST_LONG_ENTRY) {
+        ord = ldir->ord & 0X1F;
+        chksum = ldir->chksum;
+      } else if (ord > 1 && (ldir->ord & 0X1F) == ord - 1 &&
+                 ldir->chksum == chksum) {
+        ord--;
+      } else {
+        ord = 0;
+      }
+      if (ord) {
+        lfnGetName(ldir, entry[n].name, FAT_DIR_ENTRY_NAME_DIM);
+      }
+    } else {
+      ord = 0;
+    }
+  }
+  return n;
+
+fail:
+  return -1;
+}
+#endif  // FAT_DIR_ENTRY_NAME_DIM
 //------------------------------------------------------------------------------
 bool FatFile::openCluster(FatFile* file) {
   if (file->m_dirCluster == 0) {
     return openRoot(file->m_vol);
   }
-  memset(this, 0, sizeof(FatFile));
+  clearState();
   m_attr = FILE_ATTR_SUBDIR;
   m_flags = O_READ;
   m_vol = file->m_vol;
@@ -289,6 +374,63 @@ bool FatFile::parsePathName(const char* path,
   }
   return true;
 }
+#if FAT_NAME_CACHE_SIZE
+//------------------------------------------------------------------------------
+// Check that the entries at index are a file or subdirectory named fname.
+bool FatFile::nameCacheCheck(fname_t* fname, uint16_t index, uint8_t lfnOrd) {
+  uint8_t chksum = 0;
+  size_t len = fname->len;
+  dir_t* dir;
+  ldir_t* ldir;
+
+  if (lfnOrd) {
+    if (lfnOrd != (len + 12)/13 || index < lfnOrd) {
+      return false;
+    }
+    for (uint8_t ord = 1; ord <= lfnOrd; ord++) {
+      if (!seekSet(32UL*(index - ord))) {
+        return false;
+      }
+      ldir = reinterpret_cast<ldir_t*>(readDirCache());
+      if (!ldir || ldir->attr != DIR_ATT_LONG_NAME ||
+          ldir->ord != (ord == lfnOrd ? LDIR_ORD_LAST_LONG_ENTRY | ord : ord)) {
+        return false;
+      }
+      if (ord == 1) {
+        chksum = ldir->chksum;
+      } else if (ldir->chksum != chksum) {
+        return false;
+      }
+      size_t k = 13*(ord - 1);
+      for (uint8_t i = 0; i < 13; i++) {
+        uint16_t u = lfnGetChar(ldir, i);
+        if (k == len) {
+          if (u != 0) {
+            return false;
+          }
+          break;
+        }
+        if (u > 255 || lfnToLower(u) != lfnToLower(fname->lfn[k++])) {
+          return false;
+        }
+      }
+    }
+  }
+  // Read the SFN entry last so it is in the cache for openCachedEntry().
+  if (!seekSet(32UL*index)) {
+    return false;
+  }
+  dir = readDirCache();
+  if (!dir || !DIR_IS_FILE_OR_SUBDIR(dir)) {
+    return false;
+  }
+  if (lfnOrd) {
+    return lfnChecksum(dir->name) == chksum;
+  }
+  return !(fname->flags & FNAME_FLAG_LOST_CHARS) &&
+         !memcmp(dir->name, fname->sfn, sizeof(fname->sfn));
+}
+#endif  // FAT_NAME_CACHE_SIZE
 //------------------------------------------------------------------------------
 bool FatFile::open(FatFile* dirFile, fname_t* fname, uint8_t oflag) {
   bool fnameFound = false;
@@ -302,6 +444,9 @@ bool FatFile::open(FatFile* dirFile, fname_t* fname, uint8_t oflag) {
   dir_t* dir;
   ldir_t* ldir;
   size_t len = fname->len;
+#if FAT_NAME_CACHE_SIZE
+  uint16_t hash;
+#endif  // FAT_NAME_CACHE_SIZE
 
   if (!dirFile->isDir() || isOpen()) {
     DBG_FAIL_MACRO;
@@ -310,6 +455,20 @@ bool FatFile::open(FatFile* dirFile, fname_t* fname, uint8_t oflag) {
   // Number of directory entries needed.
   freeNeed = fname->flags & FNAME_FLAG_NEED_LFN ? 1 + (len + 12)/13 : 1;
 
+#if FAT_NAME_CACHE_SIZE
+  // Try recently opened names before scanning the directory.
+  hash = lfnNameHash(fname);
+  for (uint8_t i = 0; i < FAT_NAME_CACHE_SIZE; i++) {
+    FatVolume::FatNameCache_t* nc = &dirFile->m_vol->m_nameCache[i];
+    if (nc->dirCluster == dirFile->m_firstCluster && nc->hash == hash &&
+        dirFile->nameCacheCheck(fname, nc->index, nc->lfnOrd)) {
+      curIndex = nc->index;
+      lfnOrd = nc->lfnOrd;
+      goto found;
+    }
+  }
+#endif  // FAT_NAME_CACHE_SIZE
+
   dirFile->rewind();
   while (1) {
     curIndex = dirFile->m_curPosition/32;
@@ -474,8 +633,11 @@ create:
 
   // set timestamps
   if (m_dateTime) {
-    // call user date/time function
-    m_dateTime(&dir->creationDate, &dir->creationTime);
+    // call user date/time function, dir is packed so use locals
+    uint16_t date, time;
+    m_dateTime(&date, &time);
+    dir->creationDate = date;
+    dir->creationTime = time;
   } else {
     // use default date/time
     dir->creationDate = FAT_DEFAULT_DATE;
@@ -494,6 +656,9 @@ open:
     DBG_FAIL_MACRO;
     goto fail;
   }
+#if FAT_NAME_CACHE_SIZE
+  m_vol->nameCacheAdd(m_dirCluster, hash, curIndex, lfnOrd);
+#endif  // FAT_NAME_CACHE_SIZE
   return true;
 
 fail:
@@ -579,12 +744,15 @@ bool FatFile::remove() {
 
   // Mark entry deleted.
   dir->name[0] = DIR_NAME_DELETED;
+#if FAT_NAME_CACHE_SIZE
+  m_vol->nameCacheInvalidate(m_dirCluster, m_dirIndex);
+#endif  // FAT_NAME_CACHE_SIZE
 
   // Set this file closed.
   m_attr = FILE_ATTR_CLOSED;
 
   // Write entry to device.
-  if (!m_vol->cacheSync()) {
+  if (!m_vol->removeSync()) {
     DBG_FAIL_MACRO;
     goto fail;
   }
@@ -616,7 +784,7 @@ bool FatFile::remove() {
     ldir->ord = DIR_NAME_DELETED;
     m_vol->cacheDirty();
     if (last) {
-      if (!m_vol->cacheSync()) {
+      if (!m_vol->removeSync()) {
         DBG_FAIL_MACRO;
         goto fail;
       }
@@ -220,8 +220,11 @@ bool FatFile::open(FatFile* dirFile, fname_t* fname, uint8_t oflag) {
 
   // set timestamps
   if (m_dateTime) {
-    // call user date/time function
-    m_dateTime(&dir->creationDate, &dir->creationTime);
+    // call user date/time function, dir is packed so use locals
+    uint16_t date, time;
+    m_dateTime(&date, &time);
+    dir->creationDate = date;
+    dir->creationTime = time;
   } else {
     // use default date/time
     dir->creationDate = FAT_DEFAULT_DATE;
@@ -240,6 +243,56 @@ bool FatFile::open(FatFile* dirFile, fname_t* fname, uint8_t oflag) {
 fail:
   return false;
 }
+#if FAT_DIR_ENTRY_NAME_DIM
+//------------------------------------------------------------------------------
+int FatFile::readDirEntries(FatDirEntry_t* entry, uint16_t count,
+                            FatDirEntryFilter_t filter, void* arg) {
+  uint16_t index;
+  uint16_t n = 0;
+  int8_t keep;
+  dir_t* dir;
+
+  if (!isDir() || (curPosition() & 0X1F)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  while (n < count) {
+    index = curPosition()/32;
+    dir = readDirCache();
+    if (!dir) {
+      if (getError()) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      break;
+    }
+    if (dir->name[0] == DIR_NAME_FREE) {
+      // Leave the end marker for the next call.
+      if (!seekCur(-32)) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      break;
+    }
+    if (dir->name[0] != '.' && dir->name[0] != DIR_NAME_DELETED &&
+        DIR_IS_FILE_OR_SUBDIR(dir)) {
+      dirEntryCopy(dir, index, &entry[n]);
+      dirName(dir, entry[n].name);
+      keep = filter ? filter(&entry[n], arg) : 1;
+      if (keep < 0) {
+        break;
+      }
+      if (keep) {
+        n++;
+      }
+    }
+  }
+  return n;
+
+fail:
+  return -1;
+}
+#endif  // FAT_DIR_ENTRY_NAME_DIM
 //------------------------------------------------------------------------------
 size_t FatFile::printName(print_t* pr) {
   return printSFN(pr);
@@ -270,7 +323,7 @@ bool FatFile::remove() {
   m_attr = FILE_ATTR_CLOSED;
 
   // Write entry to device.
-  return m_vol->cacheSync();
+  return m_vol->removeSync();
 
 fail:
   return false;
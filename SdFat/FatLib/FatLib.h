@@ -30,6 +30,7 @@
 #include "FatLibConfig.h"
 #include "FatVolume.h"
 #include "FatFile.h"
+#include "FatScanner.h"
 #include "StdioStream.h"
 #include "fstream.h"
 //------------------------------------------------------------------------------
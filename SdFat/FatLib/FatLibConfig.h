@@ -71,6 +71,89 @@
 #endif  // __arm__
 #endif  // USE_SEPARATE_FAT_CACHE
 //------------------------------------------------------------------------------
+/**
+ * Number of 512 byte blocks in each FatVolume block cache.
+ */
+#ifndef FAT_CACHE_BLOCK_COUNT
+#define FAT_CACHE_BLOCK_COUNT 1
+#endif  // FAT_CACHE_BLOCK_COUNT
+//------------------------------------------------------------------------------
+/**
+ * Set USE_FAT_EXTENT_CACHE nonzero to cache cluster runs in each FatFile.
+ */
+#ifndef USE_FAT_EXTENT_CACHE
+#define USE_FAT_EXTENT_CACHE 0
+#endif  // USE_FAT_EXTENT_CACHE
+#ifndef FAT_EXTENT_CACHE_SIZE
+#define FAT_EXTENT_CACHE_SIZE 4
+#endif  // FAT_EXTENT_CACHE_SIZE
+//------------------------------------------------------------------------------
+/**
+ * FAT_NAME_CACHE_SIZE nonzero keeps the directory index of that many
+ * recently opened long file names in each volume.
+ */
+#ifndef FAT_NAME_CACHE_SIZE
+#define FAT_NAME_CACHE_SIZE 0
+#endif  // FAT_NAME_CACHE_SIZE
+//------------------------------------------------------------------------------
+/**
+ * FAT_DIR_ENTRY_NAME_DIM nonzero enables FatFile::readDirEntries() with
+ * names of that many bytes in each FatDirEntry_t.
+ */
+#ifndef FAT_DIR_ENTRY_NAME_DIM
+#define FAT_DIR_ENTRY_NAME_DIM 0
+#endif  // FAT_DIR_ENTRY_NAME_DIM
+//------------------------------------------------------------------------------
+/**
+ * FAT_FREE_BATCH_SIZE nonzero frees cluster chains in sorted batches of
+ * that many clusters.
+ */
+#ifndef FAT_FREE_BATCH_SIZE
+#define FAT_FREE_BATCH_SIZE 0
+#endif  // FAT_FREE_BATCH_SIZE
+//------------------------------------------------------------------------------
+/**
+ * FAT_DIR_SYNC_LAG nonzero lets sync() leave the size in the directory
+ * entry up to that many bytes behind a growing file.
+ */
+#ifndef FAT_DIR_SYNC_LAG
+#define FAT_DIR_SYNC_LAG 0
+#endif  // FAT_DIR_SYNC_LAG
+//------------------------------------------------------------------------------
+/**
+ * STDIO_STREAM_BUF_SIZE is the size of the StdioStream buffer, 16 to 65535.
+ */
+#ifndef STDIO_STREAM_BUF_SIZE
+#define STDIO_STREAM_BUF_SIZE 64
+#endif  // STDIO_STREAM_BUF_SIZE
+//------------------------------------------------------------------------------
+/**
+ * FAT_MIRROR_MODE zero writes the second FAT with the first, one defers
+ * second FAT writes to cache sync, two writes only the first FAT.
+ */
+#ifndef FAT_MIRROR_MODE
+#define FAT_MIRROR_MODE 0
+#endif  // FAT_MIRROR_MODE
+#ifndef FAT_MIRROR_PENDING_BLOCKS
+#define FAT_MIRROR_PENDING_BLOCKS 8
+#endif  // FAT_MIRROR_PENDING_BLOCKS
+//------------------------------------------------------------------------------
+/**
+ * Set USE_ASYNC_BLOCK_IO nonzero to add the writeBlockStart(),
+ * readBlocksStart() and poll() calls to block drivers.
+ */
+#ifndef USE_ASYNC_BLOCK_IO
+#define USE_ASYNC_BLOCK_IO 0
+#endif  // USE_ASYNC_BLOCK_IO
+//------------------------------------------------------------------------------
+/**
+ * FAT_FREE_MAP_BYTES nonzero keeps a bitmap of cluster groups that may have
+ * free clusters so allocateCluster() can skip groups known to be full.
+ */
+#ifndef FAT_FREE_MAP_BYTES
+#define FAT_FREE_MAP_BYTES 0
+#endif  // FAT_FREE_MAP_BYTES
+//------------------------------------------------------------------------------
 /**
  * Set USE_MULTI_BLOCK_IO non-zero to use multi-block SD read/write.
  *
@@ -84,6 +167,16 @@
 #endif  // RAMEND
 #endif  // USE_MULTI_BLOCK_IO
 //------------------------------------------------------------------------------
+/**
+ * Number of blocks in the FatVolume read-ahead buffer, zero for none.
+ */
+#ifndef FAT_READ_AHEAD_BLOCKS
+#define FAT_READ_AHEAD_BLOCKS 0
+#endif  // FAT_READ_AHEAD_BLOCKS
+#if FAT_READ_AHEAD_BLOCKS && !USE_MULTI_BLOCK_IO
+#error FAT_READ_AHEAD_BLOCKS requires USE_MULTI_BLOCK_IO
+#endif  // FAT_READ_AHEAD_BLOCKS && !USE_MULTI_BLOCK_IO
+//------------------------------------------------------------------------------
 /**
  * Set MAINTAIN_FREE_CLUSTER_COUNT nonzero to keep the count of free clusters
  * updated.  This will increase the speed of the freeClusterCount() call
@@ -93,6 +186,33 @@
 #define MAINTAIN_FREE_CLUSTER_COUNT 0
 #endif  // MAINTAIN_FREE_CLUSTER_COUNT
 //------------------------------------------------------------------------------
+/**
+ * Set USE_FSINFO_FREE_COUNT nonzero to seed the free cluster count of FAT32
+ * volumes from the FSINFO sector and write it back when the volume is synced.
+ * Requires MAINTAIN_FREE_CLUSTER_COUNT nonzero.
+ */
+#ifndef USE_FSINFO_FREE_COUNT
+#define USE_FSINFO_FREE_COUNT 0
+#endif  // USE_FSINFO_FREE_COUNT
+//------------------------------------------------------------------------------
+/**
+ * Set USE_FAT_IO_COUNTERS nonzero to count blocks read and written.
+ */
+#ifndef USE_FAT_IO_COUNTERS
+#define USE_FAT_IO_COUNTERS 0
+#endif  // USE_FAT_IO_COUNTERS
+//------------------------------------------------------------------------------
+/**
+ * Set USE_FAT_IO_TRACE nonzero to trace the last FAT_IO_TRACE_SIZE block
+ * I/O and cache operations.  Requires ENABLE_ARDUINO_FEATURES for micros().
+ */
+#ifndef USE_FAT_IO_TRACE
+#define USE_FAT_IO_TRACE 0
+#endif  // USE_FAT_IO_TRACE
+#ifndef FAT_IO_TRACE_SIZE
+#define FAT_IO_TRACE_SIZE 64
+#endif  // FAT_IO_TRACE_SIZE
+//------------------------------------------------------------------------------
 /**
  * Set DESTRUCTOR_CLOSES_FILE non-zero to close a file in its destructor.
  *
@@ -0,0 +1,137 @@
+/**
+ * Copyright (c) 20011-2017 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <string.h>
+#include "FatScanner.h"
+//------------------------------------------------------------------------------
+bool FatScanner::begin(FatVolume* vol) {
+  m_vol = 0;
+  if (vol->fatType() != 16 && vol->fatType() != 32) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_vol = vol;
+  m_fatWriteCount = vol->m_fatWriteCount;
+  // Entries for clusters zero and one are reserved.
+  m_cluster = 2;
+  m_blocksDone = 0;
+  m_blocksTotal = vol->fatType() == 16 ?
+                  (vol->m_lastCluster >> 8) + 1 : (vol->m_lastCluster >> 7) + 1;
+  m_freeCount = 0;
+  m_runStart = 0;
+  m_runLength = 0;
+  m_largestRun = 0;
+  m_largestRunStart = 0;
+  memset(m_histogram, 0, sizeof(m_histogram));
+  return true;
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+void FatScanner::endRun() {
+  uint8_t bin = 0;
+  if (!m_runLength) {
+    return;
+  }
+  for (uint32_t n = m_runLength; n > 1 && bin < (HISTOGRAM_BINS - 1); n >>= 1) {
+    bin++;
+  }
+  m_histogram[bin]++;
+  if (m_runLength > m_largestRun) {
+    m_largestRun = m_runLength;
+    m_largestRunStart = m_runStart;
+  }
+  m_runLength = 0;
+}
+//------------------------------------------------------------------------------
+int8_t FatScanner::step(uint16_t maxBlocks, uint32_t maxMicros) {
+  bool fat16;
+  uint16_t shift;
+  uint16_t mask;
+#if ENABLE_ARDUINO_FEATURES
+  uint32_t startMicros = micros();
+#else  // ENABLE_ARDUINO_FEATURES
+  (void)maxMicros;
+#endif  // ENABLE_ARDUINO_FEATURES
+  if (!m_vol) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  fat16 = m_vol->fatType() == 16;
+  shift = fat16 ? 8 : 7;
+  mask = fat16 ? 0XFF : 0X7F;
+  while (!isDone() && maxBlocks--) {
+    // Read through the FAT cache so unsynced FAT changes are seen.
+    uint32_t lba = m_vol->m_fatStartBlock + (m_cluster >> shift);
+    cache_t* pc = m_vol->cacheFetchFat(lba, FatCache::CACHE_FOR_READ);
+    if (!pc) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    uint16_t i = m_cluster & mask;
+    uint16_t n = mask + 1;
+    if ((m_cluster - i + n - 1) > m_vol->m_lastCluster) {
+      n = m_vol->m_lastCluster - (m_cluster - i) + 1;
+    }
+    for (; i < n; i++, m_cluster++) {
+      uint32_t f = fat16 ? pc->fat16[i] : pc->fat32[i] & FAT32MASK;
+      if (f == 0) {
+        if (!m_runLength) {
+          m_runStart = m_cluster;
+        }
+        m_runLength++;
+        m_freeCount++;
+      } else {
+        endRun();
+      }
+    }
+    m_blocksDone++;
+#if ENABLE_ARDUINO_FEATURES
+    if (maxMicros && (micros() - startMicros) >= maxMicros) {
+      break;
+    }
+#endif  // ENABLE_ARDUINO_FEATURES
+  }
+  if (!isDone()) {
+    return SCAN_BUSY;
+  }
+  endRun();
+  return SCAN_DONE;
+
+fail:
+  return SCAN_ERROR;
+}
+//------------------------------------------------------------------------------
+bool FatScanner::setVolumeFreeCount() {
+  if (!isDone() || isStale()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_vol->setFreeClusterCount(m_freeCount);
+  return true;
+
+fail:
+  return false;
+}
@@ -0,0 +1,132 @@
+/**
+ * Copyright (c) 20011-2017 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef FatScanner_h
+#define FatScanner_h
+/**
+ * \file
+ * \brief FatScanner class
+ */
+#include "FatVolume.h"
+//==============================================================================
+/**
+ * \class FatScanner
+ * \brief Resumable, time-sliced scan of a FAT16 or FAT32 volume's FAT.
+ *
+ * Each call to step() examines at most a given number of FAT blocks, or
+ * stops after a given time, so a scan of a large card can be spread over
+ * many passes of the application's loop.  When the scan is done it reports
+ * the free cluster count, the largest run of free clusters and a histogram
+ * of free run lengths.
+ *
+ * FAT changes made while a scan is in progress are detected. The results
+ * of such a scan are not used to set the volume's free cluster count.
+ */
+class FatScanner {
+ public:
+  /** Number of bins in the free run histogram.  Bin n counts free runs
+   *  of length 2^n to 2^(n+1) - 1 clusters, the last bin counts all
+   *  longer runs.
+   */
+  static const uint8_t HISTOGRAM_BINS = 16;
+  /** step() return for scan not finished. */
+  static const int8_t SCAN_BUSY = 0;
+  /** step() return for scan finished. */
+  static const int8_t SCAN_DONE = 1;
+  /** step() return for an I/O error or no scan started. */
+  static const int8_t SCAN_ERROR = -1;
+
+  FatScanner() : m_vol(0) {}
+  /** Start a new scan.
+   *
+   * \param[in] vol Volume to scan.
+   *
+   * \return true for success or false for an unsupported FAT type.
+   */
+  bool begin(FatVolume* vol);
+  /** Continue the scan.
+   *
+   * \param[in] maxBlocks Maximum number of FAT blocks to examine.
+   * \param[in] maxMicros Return after this many microseconds, zero for
+   *                      no time limit.  At least one block is examined.
+   *
+   * \return SCAN_BUSY, SCAN_DONE or SCAN_ERROR.
+   */
+  int8_t step(uint16_t maxBlocks, uint32_t maxMicros = 0);
+  /** \return true if the scan is finished. */
+  bool isDone() const {
+    return m_vol && m_cluster > m_vol->m_lastCluster;
+  }
+  /** \return true if the FAT changed while the scan was in progress. */
+  bool isStale() const {
+    return m_vol && m_fatWriteCount != m_vol->m_fatWriteCount;
+  }
+  /** \return Number of FAT blocks examined so far. */
+  uint32_t blocksDone() const {
+    return m_blocksDone;
+  }
+  /** \return Total number of FAT blocks to examine. */
+  uint32_t blocksTotal() const {
+    return m_blocksTotal;
+  }
+  /** \return Free clusters found so far. */
+  uint32_t freeCount() const {
+    return m_freeCount;
+  }
+  /** \return Length in clusters of the largest free run found so far. */
+  uint32_t largestFreeRun() const {
+    return m_largestRun;
+  }
+  /** \return First cluster of the largest free run found so far. */
+  uint32_t largestFreeRunStart() const {
+    return m_largestRunStart;
+  }
+  /** \return Number of free runs found so far in histogram bin n.
+   * \param[in] n Bin number, less than HISTOGRAM_BINS.
+   */
+  uint32_t histogram(uint8_t n) const {
+    return n < HISTOGRAM_BINS ? m_histogram[n] : 0;
+  }
+  /** Set the volume's maintained free cluster count from a finished scan.
+   *
+   * \return true for success or false if the scan isn't done or is stale.
+   */
+  bool setVolumeFreeCount();
+
+ private:
+  void endRun();
+
+  FatVolume* m_vol;
+  uint16_t m_fatWriteCount;   // Volume FAT write count at begin().
+  uint32_t m_cluster;         // Next cluster to examine.
+  uint32_t m_blocksDone;
+  uint32_t m_blocksTotal;
+  uint32_t m_freeCount;
+  uint32_t m_runStart;        // First cluster of current free run.
+  uint32_t m_runLength;       // Length of current free run, zero if none.
+  uint32_t m_largestRun;
+  uint32_t m_largestRunStart;
+  uint32_t m_histogram[HISTOGRAM_BINS];
+};
+#endif  // FatScanner_h
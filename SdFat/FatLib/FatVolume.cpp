@@ -24,45 +24,122 @@
  */
 #include <string.h>
 #include "FatVolume.h"
+#include "FmtNumber.h"
+//------------------------------------------------------------------------------
+int8_t FatCache::find(uint32_t lbn) {
+  for (uint8_t i = 0; i < FAT_CACHE_BLOCK_COUNT; i++) {
+    if (m_lbn[i] == lbn) {
+      return i;
+    }
+  }
+  return -1;
+}
+//------------------------------------------------------------------------------
+void FatCache::invalidate(uint32_t first, size_t count) {
+  for (uint8_t i = 0; i < FAT_CACHE_BLOCK_COUNT; i++) {
+    if ((m_lbn[i] - first) < count) {
+      m_status[i] = 0;
+      m_lbn[i] = 0XFFFFFFFF;
+    }
+  }
+}
 //------------------------------------------------------------------------------
 cache_t* FatCache::read(uint32_t lbn, uint8_t option) {
-  if (m_lbn != lbn) {
-    if (!sync()) {
+  int8_t i = find(lbn);
+#if USE_FAT_IO_TRACE
+  uint32_t t = micros();
+  char op = i >= 0 ? FatTrace::OP_CACHE_HIT : FatTrace::OP_CACHE_MISS;
+#endif  // USE_FAT_IO_TRACE
+  if (i < 0) {
+    // Replace the least recently used block.
+    i = m_order[FAT_CACHE_BLOCK_COUNT - 1];
+    if (!syncBlock(i)) {
       DBG_FAIL_MACRO;
       goto fail;
     }
+    m_status[i] = 0;
+    m_lbn[i] = 0XFFFFFFFF;
     if (!(option & CACHE_OPTION_NO_READ)) {
-      if (!m_vol->readBlock(lbn, m_block.data)) {
+      if (!m_vol->readBlock(lbn, m_block[i].data)) {
         DBG_FAIL_MACRO;
         goto fail;
       }
     }
-    m_status = 0;
-    m_lbn = lbn;
+    m_lbn[i] = lbn;
   }
-  m_status |= option & CACHE_STATUS_MASK;
-  return &m_block;
+  touch(i);
+  m_cur = i;
+  m_status[i] |= option & CACHE_STATUS_MASK;
+#if USE_FAT_IO_TRACE
+  m_vol->m_trace.add(op, lbn, 1, t, true);
+#endif  // USE_FAT_IO_TRACE
+  return &m_block[i];
 
 fail:
-
+#if USE_FAT_IO_TRACE
+  m_vol->m_trace.add(op, lbn, 1, t, false);
+#endif  // USE_FAT_IO_TRACE
   return 0;
 }
 //------------------------------------------------------------------------------
 bool FatCache::sync() {
-  if (m_status & CACHE_STATUS_DIRTY) {
-    if (!m_vol->writeBlock(m_lbn, m_block.data)) {
+  uint8_t code[2*FAT_CACHE_BLOCK_COUNT];
+  uint8_t n = 0;
+  // Insertion sort of block and FAT mirror writes by LBN.
+  for (uint8_t i = 0; i < FAT_CACHE_BLOCK_COUNT; i++) {
+    if (!(m_status[i] & CACHE_STATUS_DIRTY)) {
+      continue;
+    }
+    for (uint8_t c = i; ; c |= WRITE_MIRROR) {
+      uint8_t k = n++;
+      for (; k > 0 && writeLbn(code[k - 1]) > writeLbn(c); k--) {
+        code[k] = code[k - 1];
+      }
+      code[k] = c;
+      if ((c & WRITE_MIRROR) || !(m_status[i] & CACHE_STATUS_MIRROR_FAT)) {
+        break;
+      }
+    }
+  }
+  for (uint8_t k = 0; k < n; k++) {
+    if (!writeBack(code[k])) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  }
+  for (uint8_t k = 0; k < n; k++) {
+    m_status[code[k] & ~WRITE_MIRROR] &= ~CACHE_STATUS_DIRTY;
+  }
+  return true;
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+bool FatCache::sync(uint32_t first, size_t count) {
+  for (uint8_t i = 0; i < FAT_CACHE_BLOCK_COUNT; i++) {
+    if ((m_lbn[i] - first) < count && !syncBlock(i)) {
+      DBG_FAIL_MACRO;
+      return false;
+    }
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+bool FatCache::syncBlock(uint8_t i) {
+  if (m_status[i] & CACHE_STATUS_DIRTY) {
+    if (!writeBack(i)) {
       DBG_FAIL_MACRO;
       goto fail;
     }
     // mirror second FAT
-    if (m_status & CACHE_STATUS_MIRROR_FAT) {
-      uint32_t lbn = m_lbn + m_vol->blocksPerFat();
-      if (!m_vol->writeBlock(lbn, m_block.data)) {
+    if (m_status[i] & CACHE_STATUS_MIRROR_FAT) {
+      if (!writeBack(i | WRITE_MIRROR)) {
         DBG_FAIL_MACRO;
         goto fail;
       }
     }
-    m_status &= ~CACHE_STATUS_DIRTY;
+    m_status[i] &= ~CACHE_STATUS_DIRTY;
   }
   return true;
 
@@ -70,15 +147,69 @@ fail:
   return false;
 }
 //------------------------------------------------------------------------------
+void FatCache::touch(uint8_t i) {
+  uint8_t k = 0;
+  while (m_order[k] != i) {
+    k++;
+  }
+  for (; k > 0; k--) {
+    m_order[k] = m_order[k - 1];
+  }
+  m_order[0] = i;
+}
+//------------------------------------------------------------------------------
+uint32_t FatCache::writeLbn(uint8_t code) {
+  uint32_t lbn = m_lbn[code & ~WRITE_MIRROR];
+  return code & WRITE_MIRROR ? lbn + m_vol->blocksPerFat() : lbn;
+}
+//------------------------------------------------------------------------------
+bool FatCache::writeBack(uint8_t code) {
+  uint32_t lbn = writeLbn(code);
+  cache_t* pc = &m_block[code & ~WRITE_MIRROR];
+#if USE_FAT_IO_TRACE
+  uint32_t t = micros();
+  bool rtn = m_vol->writeBlock(lbn, pc->data);
+  m_vol->m_trace.add(code & WRITE_MIRROR ? FatTrace::OP_FAT_MIRROR :
+                     FatTrace::OP_CACHE_SYNC, lbn, 1, t, rtn);
+  return rtn;
+#else  // USE_FAT_IO_TRACE
+  return m_vol->writeBlock(lbn, pc->data);
+#endif  // USE_FAT_IO_TRACE
+}
+//------------------------------------------------------------------------------
 bool FatVolume::allocateCluster(uint32_t current, uint32_t* next) {
   uint32_t find = current ? current : m_allocSearchStart;
   uint32_t start = find;
+#if FAT_FREE_MAP_BYTES
+  uint32_t groupMask = ((uint32_t)1 << m_freeMapShift) - 1;
+  // True if every cluster of the current group so far was checked.
+  bool wholeGroup = false;
+#endif  // FAT_FREE_MAP_BYTES
   while (1) {
     find++;
     // If at end of FAT go to beginning of FAT.
     if (find > m_lastCluster) {
       find = 2;
     }
+#if FAT_FREE_MAP_BYTES
+    if ((find & groupMask) == 0 || find == 2) {
+      if (!freeMapTest(find)) {
+        // Skip a full group.
+        uint32_t last = find | groupMask;
+        if (last > m_lastCluster) {
+          last = m_lastCluster;
+        }
+        if (find <= start && start <= last) {
+          // Can't find space checked all other groups.
+          DBG_FAIL_MACRO;
+          goto fail;
+        }
+        find = last;
+        continue;
+      }
+      wholeGroup = true;
+    }
+#endif  // FAT_FREE_MAP_BYTES
     uint32_t f;
     int8_t fg = fatGet(find, &f);
     if (fg < 0) {
@@ -88,6 +219,12 @@ bool FatVolume::allocateCluster(uint32_t current, uint32_t* next) {
     if (fg && f == 0) {
       break;
     }
+#if FAT_FREE_MAP_BYTES
+    if (wholeGroup &&
+        ((find & groupMask) == groupMask || find == m_lastCluster)) {
+      freeMapClear(find);
+    }
+#endif  // FAT_FREE_MAP_BYTES
     if (find == start) {
       // Can't find space checked all clusters.
       DBG_FAIL_MACRO;
@@ -273,6 +410,20 @@ bool FatVolume::fatPut(uint32_t cluster, uint32_t value) {
     DBG_FAIL_MACRO;
     goto fail;
   }
+  // Let a FatScanner in progress know the FAT has changed.
+  m_fatWriteCount++;
+#if MAINTAIN_FREE_CLUSTER_COUNT && USE_FSINFO_FREE_COUNT
+  // Mark the FSINFO count unknown before the FAT on the card can change.
+  if (m_fsInfoValid && !fsInfoInvalidate()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT && USE_FSINFO_FREE_COUNT
+#if FAT_FREE_MAP_BYTES
+  if (value == 0) {
+    freeMapSet(cluster);
+  }
+#endif  // FAT_FREE_MAP_BYTES
 
   if (fatType() == 32) {
     lba = m_fatStartBlock + (cluster >> 7);
@@ -347,6 +498,13 @@ bool FatVolume::freeChain(uint32_t cluster) {
       DBG_FAIL_MACRO;
       goto fail;
     }
+#if FAT_FREE_BATCH_SIZE
+    if (m_freeBatchCount == FAT_FREE_BATCH_SIZE && !freeBatchFlush()) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    m_freeBatch[m_freeBatchCount++] = cluster;
+#else  // FAT_FREE_BATCH_SIZE
     // free cluster
     if (!fatPut(cluster, 0)) {
       DBG_FAIL_MACRO;
@@ -358,14 +516,63 @@ bool FatVolume::freeChain(uint32_t cluster) {
     if (cluster < m_allocSearchStart) {
       m_allocSearchStart = cluster;
     }
+#endif  // FAT_FREE_BATCH_SIZE
     cluster = next;
   } while (fg);
+#if FAT_FREE_BATCH_SIZE
+  if (!m_freeBatchHold && !freeBatchFlush()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+#endif  // FAT_FREE_BATCH_SIZE
+  return true;
 
+fail:
+  return false;
+}
+#if FAT_FREE_BATCH_SIZE
+//------------------------------------------------------------------------------
+bool FatVolume::freeBatchFlush() {
+  uint16_t n = m_freeBatchCount;
+  uint16_t i = 0;
+  m_freeBatchCount = 0;
+  if (n == 0) {
+    return true;
+  }
+  // Write deleted directory entries before their clusters are freed.
+  if (m_freeBatchHold && !cacheSyncData()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  // Sort by cluster so each FAT block is fetched and dirtied once.
+  for (i = 1; i < n; i++) {
+    uint32_t c = m_freeBatch[i];
+    uint16_t j = i;
+    for (; j > 0 && m_freeBatch[j - 1] > c; j--) {
+      m_freeBatch[j] = m_freeBatch[j - 1];
+    }
+    m_freeBatch[j] = c;
+  }
+  for (i = 0; i < n; i++) {
+    if (!fatPut(m_freeBatch[i], 0)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  }
+  if (m_freeBatch[0] < m_allocSearchStart) {
+    m_allocSearchStart = m_freeBatch[0];
+  }
+  updateFreeClusterCount(n);
   return true;
 
 fail:
+  // Count the clusters that were freed.
+  if (i < n) {
+    updateFreeClusterCount(i);
+  }
   return false;
 }
+#endif  // FAT_FREE_BATCH_SIZE
 //------------------------------------------------------------------------------
 int32_t FatVolume::freeClusterCount() {
 #if MAINTAIN_FREE_CLUSTER_COUNT
@@ -429,15 +636,178 @@ fail:
   return -1;
 }
 //------------------------------------------------------------------------------
+#if MAINTAIN_FREE_CLUSTER_COUNT && USE_FSINFO_FREE_COUNT
+// Seed free count and search start from a valid FAT32 FSINFO sector.
+bool FatVolume::fsInfoInit(uint32_t lbn) {
+  fat32_fsinfo_t* fsi;
+  cache_t* pc = cacheFetchData(lbn, FatCache::CACHE_FOR_READ);
+  if (!pc) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_fsInfoBlock = lbn;
+  fsi = &pc->fsinfo;
+  if (fsi->leadSignature != FSINFO_LEAD_SIG ||
+      fsi->structSignature != FSINFO_STRUCT_SIG ||
+      fsi->tailSignature[2] != 0X55 || fsi->tailSignature[3] != 0XAA) {
+    // not a FSINFO sector - don't write it
+    m_fsInfoBlock = 0;
+    return true;
+  }
+  // 0XFFFFFFFF, unknown, also fails this check.  The count is only left
+  // valid on the card by a clean sync, see fsInfoInvalidate().
+  if (fsi->freeCount <= clusterCount()) {
+    m_freeClusterCount = fsi->freeCount;
+    m_fsInfoValid = true;
+  }
+  if (fsi->nextFree >= 2 && fsi->nextFree <= m_lastCluster) {
+    m_allocSearchStart = fsi->nextFree - 1;
+  }
+  return true;
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+// Write an unknown free count to FSINFO so a reset before the next sync
+// leaves a count that the next mount won't use.
+bool FatVolume::fsInfoInvalidate() {
+  cache_t* pc = cacheFetchData(m_fsInfoBlock, FatCache::CACHE_FOR_WRITE);
+  if (!pc) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  pc->fsinfo.freeCount = 0XFFFFFFFF;
+  if (!cacheSyncData()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_fsInfoValid = false;
+  m_fsInfoDirty = true;
+  return true;
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+// Write free count and search start to FSINFO if the count has changed.
+// Called after the FAT has been synced so the count matches the card.
+bool FatVolume::fsInfoSync() {
+  fat32_fsinfo_t* fsi;
+  if (!m_fsInfoDirty || !m_fsInfoBlock) {
+    return true;
+  }
+  cache_t* pc = cacheFetchData(m_fsInfoBlock, FatCache::CACHE_FOR_WRITE);
+  if (!pc) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  fsi = &pc->fsinfo;
+  // Mark count unknown if it isn't maintained so a stale count isn't used.
+  fsi->freeCount = m_freeClusterCount >= 0 ? m_freeClusterCount : 0XFFFFFFFF;
+  fsi->nextFree = m_allocSearchStart + 1;
+  if (!cacheSyncData()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_fsInfoValid = m_freeClusterCount >= 0;
+  m_fsInfoDirty = false;
+  return true;
+
+fail:
+  return false;
+}
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT && USE_FSINFO_FREE_COUNT
+#if FAT_MIRROR_MODE == 1
+//------------------------------------------------------------------------------
+// Add a FAT block to the sorted list of blocks to copy to the second FAT.
+bool FatVolume::mirrorDirty(uint32_t blockNumber) {
+  uint8_t i = 0;
+  while (i < m_mirrorCount && m_mirrorBlock[i] < blockNumber) {
+    i++;
+  }
+  if (i < m_mirrorCount && m_mirrorBlock[i] == blockNumber) {
+    return true;
+  }
+  if (m_mirrorCount == FAT_MIRROR_PENDING_BLOCKS) {
+    if (!cacheSyncFat() || !mirrorSync()) {
+      DBG_FAIL_MACRO;
+      return false;
+    }
+    i = 0;
+  }
+  for (uint8_t k = m_mirrorCount++; k > i; k--) {
+    m_mirrorBlock[k] = m_mirrorBlock[k - 1];
+  }
+  m_mirrorBlock[i] = blockNumber;
+  return true;
+}
+//------------------------------------------------------------------------------
+// Copy FAT blocks changed since the last sync to the second FAT.
+bool FatVolume::mirrorSync() {
+  while (m_mirrorCount) {
+    uint32_t lbn = m_mirrorBlock[0];
+    cache_t* pc = cacheFetchFat(lbn, FatCache::CACHE_FOR_READ);
+    if (!pc || !writeBlock(lbn + m_blocksPerFat, pc->data)) {
+      DBG_FAIL_MACRO;
+      return false;
+    }
+    m_mirrorCount--;
+    memmove(m_mirrorBlock, m_mirrorBlock + 1, m_mirrorCount*sizeof(uint32_t));
+  }
+  return true;
+}
+#endif  // FAT_MIRROR_MODE == 1
+#if FAT_NAME_CACHE_SIZE
+//------------------------------------------------------------------------------
+// Remember where a name was found, replacing any entry for the same index.
+void FatVolume::nameCacheAdd(uint32_t dirCluster, uint16_t hash,
+                             uint16_t index, uint8_t lfnOrd) {
+  uint8_t i;
+  for (i = 0; i < FAT_NAME_CACHE_SIZE; i++) {
+    if (m_nameCache[i].dirCluster == dirCluster &&
+        m_nameCache[i].index == index) {
+      break;
+    }
+  }
+  if (i == FAT_NAME_CACHE_SIZE) {
+    i = m_nameCacheNext;
+    m_nameCacheNext = (i + 1) % FAT_NAME_CACHE_SIZE;
+  }
+  m_nameCache[i].dirCluster = dirCluster;
+  m_nameCache[i].hash = hash;
+  m_nameCache[i].index = index;
+  m_nameCache[i].lfnOrd = lfnOrd;
+}
+//------------------------------------------------------------------------------
+void FatVolume::nameCacheInvalidate(uint32_t dirCluster, uint16_t index) {
+  for (uint8_t i = 0; i < FAT_NAME_CACHE_SIZE; i++) {
+    if (m_nameCache[i].dirCluster == dirCluster &&
+        m_nameCache[i].index == index) {
+      // No directory has this first cluster.
+      m_nameCache[i].dirCluster = 0XFFFFFFFF;
+    }
+  }
+}
+#endif  // FAT_NAME_CACHE_SIZE
+//------------------------------------------------------------------------------
 bool FatVolume::init(uint8_t part) {
   uint32_t clusterCount;
   uint32_t totalBlocks;
   uint32_t volumeStartBlock = 0;
+#if MAINTAIN_FREE_CLUSTER_COUNT && USE_FSINFO_FREE_COUNT
+  uint16_t fsInfoSector;
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT && USE_FSINFO_FREE_COUNT
   fat32_boot_t* fbs;
   cache_t* pc;
   uint8_t tmp;
   m_fatType = 0;
   m_allocSearchStart = 1;
+  m_fatWriteCount = 0;
+#if FAT_READ_AHEAD_BLOCKS
+  m_readAheadCount = 0;
+  m_readAheadNext = 0XFFFFFFFF;
+#endif  // FAT_READ_AHEAD_BLOCKS
   m_cache.init(this);
 #if USE_SEPARATE_FAT_CACHE
   m_fatCache.init(this);
@@ -489,6 +859,18 @@ bool FatVolume::init(uint8_t part) {
                    fbs->sectorsPerFat16 : fbs->sectorsPerFat32;
 
   m_fatStartBlock = volumeStartBlock + fbs->reservedSectorCount;
+#if FAT_MIRROR_MODE == 1
+  m_mirrorCount = 0;
+#endif  // FAT_MIRROR_MODE == 1
+#if FAT_NAME_CACHE_SIZE
+  // Set dirCluster to 0XFFFFFFFF in all entries.
+  memset(m_nameCache, 0XFF, sizeof(m_nameCache));
+  m_nameCacheNext = 0;
+#endif  // FAT_NAME_CACHE_SIZE
+#if FAT_FREE_BATCH_SIZE
+  m_freeBatchCount = 0;
+  m_freeBatchHold = false;
+#endif  // FAT_FREE_BATCH_SIZE
 
   // count for FAT16 zero for FAT32
   m_rootDirEntryCount = fbs->rootDirEntryCount;
@@ -507,9 +889,24 @@ bool FatVolume::init(uint8_t part) {
   // divide by cluster size to get cluster count
   clusterCount >>= m_clusterSizeShift;
   m_lastCluster = clusterCount + 1;
+#if FAT_FREE_MAP_BYTES
+  // Assume every group has free clusters until a scan shows it is full.
+  memset(m_freeMap, 0XFF, sizeof(m_freeMap));
+  m_freeMapShift = 0;
+  while ((m_lastCluster >> m_freeMapShift) >= 8*FAT_FREE_MAP_BYTES) {
+    m_freeMapShift++;
+  }
+#endif  // FAT_FREE_MAP_BYTES
 
   // Indicate unknown number of free clusters.
   setFreeClusterCount(-1);
+#if MAINTAIN_FREE_CLUSTER_COUNT && USE_FSINFO_FREE_COUNT
+  // Save FSINFO sector before the cache is reused.
+  fsInfoSector = fbs->fat32FSInfo;
+  m_fsInfoBlock = 0;
+  m_fsInfoDirty = false;
+  m_fsInfoValid = false;
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT && USE_FSINFO_FREE_COUNT
   // FAT type is determined by cluster count
   if (clusterCount < 4085) {
     m_fatType = 12;
@@ -522,12 +919,50 @@ bool FatVolume::init(uint8_t part) {
   } else {
     m_rootDirStart = fbs->fat32RootCluster;
     m_fatType = 32;
+#if MAINTAIN_FREE_CLUSTER_COUNT && USE_FSINFO_FREE_COUNT
+    if (fsInfoSector && !fsInfoInit(volumeStartBlock + fsInfoSector)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT && USE_FSINFO_FREE_COUNT
   }
   return true;
 
 fail:
   return false;
 }
+#if FAT_READ_AHEAD_BLOCKS
+//------------------------------------------------------------------------------
+// Return 1 with data set if block is in the read-ahead buffer or block
+// continues a sequential read and up to maxBlocks were read ahead.
+// Return 0 if block is not in the buffer, -1 for an I/O error.
+int8_t FatVolume::readAhead(uint32_t block, size_t maxBlocks, uint8_t** data) {
+  uint32_t i = block - m_readAheadBlock;
+  bool sequential = block == m_readAheadNext;
+  m_readAheadNext = block + 1;
+  if (i < m_readAheadCount) {
+    *data = m_readAheadBuf + 512*i;
+    return 1;
+  }
+  if (!sequential || maxBlocks < 2) {
+    return 0;
+  }
+  if (maxBlocks > FAT_READ_AHEAD_BLOCKS) {
+    maxBlocks = FAT_READ_AHEAD_BLOCKS;
+  }
+  // Dirty cached blocks must be written before the device is read.
+  m_readAheadCount = 0;
+  if (!cacheSyncData(block, maxBlocks) ||
+      !readBlocks(block, m_readAheadBuf, maxBlocks)) {
+    DBG_FAIL_MACRO;
+    return -1;
+  }
+  m_readAheadBlock = block;
+  m_readAheadCount = maxBlocks;
+  *data = m_readAheadBuf;
+  return 1;
+}
+#endif  // FAT_READ_AHEAD_BLOCKS
 //------------------------------------------------------------------------------
 bool FatVolume::wipe(print_t* pr) {
   cache_t* cache;
@@ -605,3 +1040,57 @@ fail:
   m_fatType = 0;
   return false;
 }
+#if USE_FAT_IO_TRACE
+//------------------------------------------------------------------------------
+static void traceU32(print_t* pr, uint32_t v, char sep) {
+  char buf[12];
+  char* ptr = buf + sizeof(buf);
+  *--ptr = 0;
+  *--ptr = sep;
+  pr->write(fmtDec(v, ptr));
+}
+//------------------------------------------------------------------------------
+static const char* parseU32(const char* str, uint32_t* v) {
+  if (!isDigit(*str)) {
+    return 0;
+  }
+  *v = 0;
+  while (isDigit(*str)) {
+    *v = 10*(*v) + *str++ - '0';
+  }
+  return *str == ',' ? str + 1 : str;
+}
+//------------------------------------------------------------------------------
+void FatTrace::dump(print_t* pr) const {
+  pr->write("start,op,lbn,count,duration,ok\r\n");
+  for (uint16_t i = 0; i < m_count; i++) {
+    const fat_trace_t* rec = record(i);
+    traceU32(pr, rec->start, ',');
+    pr->write(rec->op);
+    pr->write(',');
+    traceU32(pr, rec->lbn, ',');
+    traceU32(pr, rec->count, ',');
+    traceU32(pr, rec->duration, ',');
+    pr->write(rec->ok ? '1' : '0');
+    pr->write('\r');
+    pr->write('\n');
+  }
+}
+//------------------------------------------------------------------------------
+bool FatTrace::parseLine(const char* str, fat_trace_t* rec) {
+  uint32_t v;
+  if (!(str = parseU32(str, &rec->start)) || !str[0] || str[1] != ',') {
+    return false;
+  }
+  rec->op = str[0];
+  if (!(str = parseU32(str + 2, &rec->lbn)) || !(str = parseU32(str, &v))) {
+    return false;
+  }
+  rec->count = v;
+  if (!(str = parseU32(str, &rec->duration)) || !(str = parseU32(str, &v))) {
+    return false;
+  }
+  rec->ok = v != 0;
+  return true;
+}
+#endif  // USE_FAT_IO_TRACE
@@ -94,6 +94,125 @@ union cache_t {
   /** Used to access to a cached FAT32 FSINFO sector. */
   fat32_fsinfo_t fsinfo;
 };
+#if USE_FAT_IO_TRACE
+#if !ENABLE_ARDUINO_FEATURES
+#error USE_FAT_IO_TRACE requires micros() from ENABLE_ARDUINO_FEATURES
+#endif  // !ENABLE_ARDUINO_FEATURES
+//==============================================================================
+/**
+ * \struct fat_trace_t
+ * \brief Block I/O trace record.
+ */
+struct fat_trace_t {
+  /** micros() at start of operation. */
+  uint32_t start;
+  /** Elapsed micros for the operation, includes card busy time. */
+  uint32_t duration;
+  /** First logical block of the operation. */
+  uint32_t lbn;
+  /** Number of blocks. */
+  uint16_t count;
+  /** Operation code, one of the FatTrace::OP_ characters. */
+  char op;
+  /** One for success, zero for failure. */
+  uint8_t ok;
+};
+//==============================================================================
+/**
+ * \class FatTrace
+ * \brief Ring of the last FAT_IO_TRACE_SIZE block operations.
+ *
+ * A dump is CSV with one record per line, oldest first:
+ *
+ *    start,op,lbn,count,duration,ok
+ *
+ * Lines read back with parseLine() may be replayed against a block driver.
+ */
+class FatTrace {
+ public:
+  /** Single block read from the device. */
+  static const char OP_READ = 'R';
+  /** Single block write to the device. */
+  static const char OP_WRITE = 'W';
+  /** Multiple block read from the device. */
+  static const char OP_READ_MULTI = 'r';
+  /** Multiple block write to the device. */
+  static const char OP_WRITE_MULTI = 'w';
+  /** Device sync. */
+  static const char OP_SYNC_DEVICE = 'Y';
+  /** Cache read found the block in the cache. */
+  static const char OP_CACHE_HIT = 'H';
+  /** Cache read had to replace the cached block. */
+  static const char OP_CACHE_MISS = 'M';
+  /** Cache sync wrote a dirty block. */
+  static const char OP_CACHE_SYNC = 'S';
+  /** Cache sync wrote the second FAT copy of a dirty block. */
+  static const char OP_FAT_MIRROR = 'F';
+
+  FatTrace() : m_next(0), m_count(0) {}
+  /** Add a record to the trace.
+   *
+   * \param[in] op Operation code.
+   * \param[in] lbn First logical block.
+   * \param[in] count Number of blocks.
+   * \param[in] start micros() at the start of the operation.
+   * \param[in] ok Operation status.
+   */
+  void add(char op, uint32_t lbn, uint16_t count, uint32_t start, bool ok) {
+    fat_trace_t* rec = &m_ring[m_next];
+    rec->start = start;
+    rec->duration = micros() - start;
+    rec->lbn = lbn;
+    rec->count = count;
+    rec->op = op;
+    rec->ok = ok;
+    if (++m_next >= FAT_IO_TRACE_SIZE) {
+      m_next = 0;
+    }
+    if (m_count < FAT_IO_TRACE_SIZE) {
+      m_count++;
+    }
+  }
+  /** Remove all records. */
+  void clear() {
+    m_next = 0;
+    m_count = 0;
+  }
+  /** \return Number of records in the trace. */
+  uint16_t count() const {
+    return m_count;
+  }
+  /** Print the trace as CSV, oldest record first.
+   * \param[in] pr Print stream for output.
+   */
+  void dump(print_t* pr) const;
+  /** Parse one line of a dump.
+   *
+   * \param[in] str Line of text.
+   * \param[out] rec Record from the line.
+   * \return true for success or false if \a str is not a trace record.
+   */
+  static bool parseLine(const char* str, fat_trace_t* rec);
+  /** \param[in] i Index of record, zero is the oldest.
+   * \return Pointer to the record or zero if \a i is out of range.
+   */
+  const fat_trace_t* record(uint16_t i) const {
+    if (i >= m_count) {
+      return 0;
+    }
+    i += m_next + FAT_IO_TRACE_SIZE - m_count;
+    return &m_ring[i % FAT_IO_TRACE_SIZE];
+  }
+
+ private:
+  uint16_t m_next;
+  uint16_t m_count;
+  fat_trace_t m_ring[FAT_IO_TRACE_SIZE];
+};
+#endif  // USE_FAT_IO_TRACE
+#if FAT_CACHE_BLOCK_COUNT < 1 || FAT_CACHE_BLOCK_COUNT > 64
+#error FAT_CACHE_BLOCK_COUNT must be 1 to 64
+#endif  // FAT_CACHE_BLOCK_COUNT
 //==============================================================================
 /**
  * \class FatCache
@@ -119,11 +238,11 @@ class FatCache {
     = CACHE_STATUS_DIRTY | CACHE_OPTION_NO_READ;
   /** \return Cache block address. */
   cache_t* block() {
-    return &m_block;
+    return &m_block[m_cur];
   }
   /** Set current block dirty. */
   void dirty() {
-    m_status |= CACHE_STATUS_DIRTY;
+    m_status[m_cur] |= CACHE_STATUS_DIRTY;
   }
   /** Initialize the cache.
    * \param[in] vol FatVolume that owns this FatCache.
@@ -132,34 +251,65 @@ class FatCache {
     m_vol = vol;
     invalidate();
   }
-  /** Invalidate current cache block. */
+  /** Invalidate all cached blocks. */
   void invalidate() {
-    m_status = 0;
-    m_lbn = 0XFFFFFFFF;
+    for (uint8_t i = 0; i < FAT_CACHE_BLOCK_COUNT; i++) {
+      m_status[i] = 0;
+      m_lbn[i] = 0XFFFFFFFF;
+      m_order[i] = i;
+    }
+    m_cur = 0;
   }
+  /** Invalidate cached blocks in a range.  Dirty data is discarded.
+   * \param[in] first First block of range.
+   * \param[in] count Number of blocks in range.
+   */
+  void invalidate(uint32_t first, size_t count);
   /** \return dirty status */
   bool isDirty() {
-    return m_status & CACHE_STATUS_DIRTY;
+    return m_status[m_cur] & CACHE_STATUS_DIRTY;
+  }
+  /** \param[in] lbn Logical block number.
+   * \return true if the block is in the cache.
+   */
+  bool isCached(uint32_t lbn) {
+    return find(lbn) >= 0;
   }
   /** \return Logical block number for cached block. */
   uint32_t lbn() {
-    return m_lbn;
+    return m_lbn[m_cur];
   }
   /** Read a block into the cache.
    * \param[in] lbn Block to read.
    * \param[in] option mode for cached block.
    * \return Address of cached block. */
   cache_t* read(uint32_t lbn, uint8_t option);
-  /** Write current block if dirty.
+  /** Write all dirty blocks in LBN order.
    * \return true for success else false.
    */
   bool sync();
+  /** Write dirty blocks in a range.
+   * \param[in] first First block of range.
+   * \param[in] count Number of blocks in range.
+   * \return true for success else false.
+   */
+  bool sync(uint32_t first, size_t count);
 
  private:
-  uint8_t m_status;
+  // Flag in a write-back code for the second FAT copy of a block.
+  static const uint8_t WRITE_MIRROR = 0X80;
+  int8_t find(uint32_t lbn);
+  bool syncBlock(uint8_t i);
+  void touch(uint8_t i);
+  uint32_t writeLbn(uint8_t code);
+  bool writeBack(uint8_t code);
+
+  uint8_t m_cur;
   FatVolume* m_vol;
-  uint32_t m_lbn;
-  cache_t m_block;
+  uint8_t m_order[FAT_CACHE_BLOCK_COUNT];    // Most recently used first.
+  uint8_t m_status[FAT_CACHE_BLOCK_COUNT];
+  uint32_t m_lbn[FAT_CACHE_BLOCK_COUNT];
+  cache_t m_block[FAT_CACHE_BLOCK_COUNT];
 };
 //==============================================================================
 /**
@@ -170,7 +320,25 @@ class FatVolume {
  public:
   /** Create an instance of FatVolume
    */
+#if USE_FAT_IO_COUNTERS
+  FatVolume() : m_fatType(0), m_blockReadCount(0), m_blockWriteCount(0) {}
+  /** \return Number of blocks read from the block device. */
+  uint32_t blockReadCount() const {
+    return m_blockReadCount;
+  }
+  /** \return Number of blocks written to the block device. */
+  uint32_t blockWriteCount() const {
+    return m_blockWriteCount;
+  }
+#else  // USE_FAT_IO_COUNTERS
   FatVolume() : m_fatType(0) {}
+#endif  // USE_FAT_IO_COUNTERS
+#if USE_FAT_IO_TRACE
+  /** \return The block I/O trace for this volume. */
+  FatTrace* trace() {
+    return &m_trace;
+  }
+#endif  // USE_FAT_IO_TRACE
 
   /** \return The volume's cluster size in blocks. */
   uint8_t blocksPerCluster() const {
@@ -219,6 +387,16 @@ class FatVolume {
    * \return Count of free clusters for success or -1 if an error occurs.
    */
   int32_t freeClusterCount();
+  /** \return true if the free cluster count is maintained and known, so
+   * freeClusterCount() returns it without reading the FAT.
+   */
+  bool freeClusterCountKnown() const {
+#if MAINTAIN_FREE_CLUSTER_COUNT
+    return m_freeClusterCount >= 0;
+#else  // MAINTAIN_FREE_CLUSTER_COUNT
+    return false;
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT
+  }
   /** Initialize a FAT volume.  Try partition one first then try super
    * floppy format.
    *
@@ -272,6 +450,7 @@ class FatVolume {
   friend class FatCache;
   friend class FatFile;
   friend class FatFileSystem;
+  friend class FatScanner;
 //------------------------------------------------------------------------------
   BlockDriver* m_blockDev;      // block device
   uint8_t  m_blocksPerCluster;     // Cluster size in blocks.
@@ -279,33 +458,134 @@ class FatVolume {
   uint8_t  m_clusterSizeShift;     // Cluster count to block count shift.
   uint8_t  m_fatType;              // Volume type (12, 16, OR 32).
   uint16_t m_rootDirEntryCount;    // Number of entries in FAT16 root dir.
+  uint16_t m_fatWriteCount;        // Count of FAT entry changes.
   uint32_t m_allocSearchStart;     // Start cluster for alloc search.
   uint32_t m_blocksPerFat;         // FAT size in blocks
   uint32_t m_dataStartBlock;       // First data block number.
   uint32_t m_fatStartBlock;        // Start block for first FAT.
   uint32_t m_lastCluster;          // Last cluster number in FAT.
   uint32_t m_rootDirStart;         // Start block for FAT16, cluster for FAT32.
+//------------------------------------------------------------------------------
+#if USE_FAT_IO_COUNTERS
+  uint32_t m_blockReadCount;       // Blocks read from device.
+  uint32_t m_blockWriteCount;      // Blocks written to device.
+#endif  // USE_FAT_IO_COUNTERS
+#if USE_FAT_IO_TRACE
+  FatTrace m_trace;
+#endif  // USE_FAT_IO_TRACE
+#if FAT_READ_AHEAD_BLOCKS
+  uint32_t m_readAheadBlock;       // First block in read-ahead buffer.
+  uint32_t m_readAheadNext;        // Block that continues sequential reads.
+  uint8_t  m_readAheadCount;       // Valid blocks in read-ahead buffer.
+  uint8_t  m_readAheadBuf[512*FAT_READ_AHEAD_BLOCKS];
+  int8_t readAhead(uint32_t block, size_t maxBlocks, uint8_t** data);
+  void readAheadInvalidate(uint32_t block, size_t nb) {
+    if (block < (m_readAheadBlock + m_readAheadCount) &&
+        m_readAheadBlock < (block + nb)) {
+      m_readAheadCount = 0;
+    }
+  }
+#endif  // FAT_READ_AHEAD_BLOCKS
 //------------------------------------------------------------------------------
   // block I/O functions.
   bool readBlock(uint32_t block, uint8_t* dst) {
+#if USE_FAT_IO_COUNTERS
+    m_blockReadCount++;
+#endif  // USE_FAT_IO_COUNTERS
+#if USE_FAT_IO_TRACE
+    uint32_t t = micros();
+    bool rtn = m_blockDev->readBlock(block, dst);
+    m_trace.add(FatTrace::OP_READ, block, 1, t, rtn);
+    return rtn;
+#else  // USE_FAT_IO_TRACE
     return m_blockDev->readBlock(block, dst);
+#endif  // USE_FAT_IO_TRACE
   }
   bool syncBlocks() {
+#if USE_FAT_IO_TRACE
+    uint32_t t = micros();
+    bool rtn = m_blockDev->syncBlocks();
+    m_trace.add(FatTrace::OP_SYNC_DEVICE, 0, 0, t, rtn);
+    return rtn;
+#else  // USE_FAT_IO_TRACE
     return m_blockDev->syncBlocks();
+#endif  // USE_FAT_IO_TRACE
   }
   bool writeBlock(uint32_t block, const uint8_t* src) {
+#if USE_FAT_IO_COUNTERS
+    m_blockWriteCount++;
+#endif  // USE_FAT_IO_COUNTERS
+#if FAT_READ_AHEAD_BLOCKS
+    readAheadInvalidate(block, 1);
+#endif  // FAT_READ_AHEAD_BLOCKS
+#if USE_FAT_IO_TRACE
+    uint32_t t = micros();
+    bool rtn = devWriteBlock(block, src);
+    m_trace.add(FatTrace::OP_WRITE, block, 1, t, rtn);
+    return rtn;
+#else  // USE_FAT_IO_TRACE
+    return devWriteBlock(block, src);
+#endif  // USE_FAT_IO_TRACE
+  }
+  bool devWriteBlock(uint32_t block, const uint8_t* src) {
+#if USE_ASYNC_BLOCK_IO
+    // Don't wait for programming, the next command or poll() waits.
+    return m_blockDev->writeBlockStart(block, src);
+#else  // USE_ASYNC_BLOCK_IO
     return m_blockDev->writeBlock(block, src);
+#endif  // USE_ASYNC_BLOCK_IO
   }
 #if USE_MULTI_BLOCK_IO
   bool readBlocks(uint32_t block, uint8_t* dst, size_t nb) {
+#if USE_FAT_IO_COUNTERS
+    m_blockReadCount += nb;
+#endif  // USE_FAT_IO_COUNTERS
+#if USE_FAT_IO_TRACE
+    uint32_t t = micros();
+    bool rtn = m_blockDev->readBlocks(block, dst, nb);
+    m_trace.add(FatTrace::OP_READ_MULTI, block, nb, t, rtn);
+    return rtn;
+#else  // USE_FAT_IO_TRACE
     return m_blockDev->readBlocks(block, dst, nb);
+#endif  // USE_FAT_IO_TRACE
   }
   bool writeBlocks(uint32_t block, const uint8_t* src, size_t nb) {
+#if USE_FAT_IO_COUNTERS
+    m_blockWriteCount += nb;
+#endif  // USE_FAT_IO_COUNTERS
+#if FAT_READ_AHEAD_BLOCKS
+    readAheadInvalidate(block, nb);
+#endif  // FAT_READ_AHEAD_BLOCKS
+#if USE_FAT_IO_TRACE
+    uint32_t t = micros();
+    bool rtn = m_blockDev->writeBlocks(block, src, nb);
+    m_trace.add(FatTrace::OP_WRITE_MULTI, block, nb, t, rtn);
+    return rtn;
+#else  // USE_FAT_IO_TRACE
     return m_blockDev->writeBlocks(block, src, nb);
+#endif  // USE_FAT_IO_TRACE
   }
 #endif  // USE_MULTI_BLOCK_IO
 #if MAINTAIN_FREE_CLUSTER_COUNT
   int32_t  m_freeClusterCount;     // Count of free clusters in volume.
+#if USE_FSINFO_FREE_COUNT
+  uint32_t m_fsInfoBlock;          // FSINFO block for FAT32, zero if none.
+  bool     m_fsInfoDirty;          // Free count changed since FSINFO write.
+  bool     m_fsInfoValid;          // FSINFO on the card holds a free count.
+  void setFreeClusterCount(int32_t value) {
+    m_freeClusterCount = value;
+    m_fsInfoDirty = true;
+  }
+  void updateFreeClusterCount(int32_t change) {
+    if (m_freeClusterCount >= 0) {
+      m_freeClusterCount += change;
+    }
+    m_fsInfoDirty = true;
+  }
+  bool fsInfoInit(uint32_t lbn);
+  bool fsInfoInvalidate();
+  bool fsInfoSync();
+#else  // USE_FSINFO_FREE_COUNT
   void setFreeClusterCount(int32_t value) {
     m_freeClusterCount = value;
   }
@@ -314,6 +594,7 @@ class FatVolume {
       m_freeClusterCount += change;
     }
   }
+#endif  // USE_FSINFO_FREE_COUNT
 #else  // MAINTAIN_FREE_CLUSTER_COUNT
   void setFreeClusterCount(int32_t value) {
     (void)value;
@@ -322,22 +603,100 @@ class FatVolume {
     (void)change;
   }
 #endif  // MAINTAIN_FREE_CLUSTER_COUNT
+#if !MAINTAIN_FREE_CLUSTER_COUNT || !USE_FSINFO_FREE_COUNT
+  bool fsInfoSync() {
+    return true;
+  }
+#endif  // !MAINTAIN_FREE_CLUSTER_COUNT || !USE_FSINFO_FREE_COUNT
+#if FAT_MIRROR_MODE == 1
+  uint32_t m_mirrorBlock[FAT_MIRROR_PENDING_BLOCKS];  // Sorted stale FAT2.
+  uint8_t  m_mirrorCount;          // Blocks in m_mirrorBlock.
+  bool mirrorDirty(uint32_t blockNumber);
+  bool mirrorSync();
+#else  // FAT_MIRROR_MODE == 1
+  bool mirrorSync() {
+    return true;
+  }
+#endif  // FAT_MIRROR_MODE == 1
+#if FAT_NAME_CACHE_SIZE
+  struct FatNameCache_t {
+    uint32_t dirCluster;         // First cluster of directory.
+    uint16_t hash;               // Hash of case folded name.
+    uint16_t index;              // Index of SFN entry in directory.
+    uint8_t  lfnOrd;             // Count of LFN entries before SFN entry.
+  };
+  FatNameCache_t m_nameCache[FAT_NAME_CACHE_SIZE];
+  uint8_t m_nameCacheNext;         // Next entry to replace.
+  void nameCacheAdd(uint32_t dirCluster, uint16_t hash,
+                    uint16_t index, uint8_t lfnOrd);
+  void nameCacheInvalidate(uint32_t dirCluster, uint16_t index);
+#endif  // FAT_NAME_CACHE_SIZE
+#if FAT_FREE_MAP_BYTES
+  uint8_t m_freeMap[FAT_FREE_MAP_BYTES];  // Bit clear if group is full.
+  uint8_t m_freeMapShift;          // log2 of clusters per map bit.
+  void freeMapClear(uint32_t cluster) {
+    cluster >>= m_freeMapShift;
+    m_freeMap[cluster >> 3] &= ~(1 << (cluster & 7));
+  }
+  void freeMapSet(uint32_t cluster) {
+    cluster >>= m_freeMapShift;
+    m_freeMap[cluster >> 3] |= 1 << (cluster & 7);
+  }
+  bool freeMapTest(uint32_t cluster) {
+    cluster >>= m_freeMapShift;
+    return m_freeMap[cluster >> 3] & (1 << (cluster & 7));
+  }
+#endif  // FAT_FREE_MAP_BYTES
+#if FAT_FREE_BATCH_SIZE
+  uint32_t m_freeBatch[FAT_FREE_BATCH_SIZE];  // Clusters to be freed.
+  uint16_t m_freeBatchCount;       // Clusters in m_freeBatch.
+  bool     m_freeBatchHold;        // rmRfStar() in progress.
+  bool freeBatchFlush();
+  // Sync after a remove unless rmRfStar() will sync at the end.
+  bool removeSync() {
+    return m_freeBatchHold || cacheSync();
+  }
+#else  // FAT_FREE_BATCH_SIZE
+  bool removeSync() {
+    return cacheSync();
+  }
+#endif  // FAT_FREE_BATCH_SIZE
+#if FAT_MIRROR_MODE == 0
+  static const uint8_t FAT_CACHE_MIRROR = FatCache::CACHE_STATUS_MIRROR_FAT;
+#else  // FAT_MIRROR_MODE == 0
+  static const uint8_t FAT_CACHE_MIRROR = 0;
+#endif  // FAT_MIRROR_MODE == 0
 
 // block caches
   FatCache m_cache;
 #if USE_SEPARATE_FAT_CACHE
   FatCache m_fatCache;
   cache_t* cacheFetchFat(uint32_t blockNumber, uint8_t options) {
-    return m_fatCache.read(blockNumber,
-                           options | FatCache::CACHE_STATUS_MIRROR_FAT);
+#if FAT_MIRROR_MODE == 1
+    if ((options & FatCache::CACHE_STATUS_DIRTY) && !mirrorDirty(blockNumber)) {
+      return 0;
+    }
+#endif  // FAT_MIRROR_MODE == 1
+    return m_fatCache.read(blockNumber, options | FAT_CACHE_MIRROR);
+  }
+  bool cacheSyncFat() {
+    return m_fatCache.sync();
   }
   bool cacheSync() {
-    return m_cache.sync() && m_fatCache.sync() && syncBlocks();
+    return m_cache.sync() && m_fatCache.sync() && mirrorSync() &&
+           fsInfoSync() && syncBlocks();
   }
 #else  //
   cache_t* cacheFetchFat(uint32_t blockNumber, uint8_t options) {
-    return cacheFetchData(blockNumber,
-                          options | FatCache::CACHE_STATUS_MIRROR_FAT);
+#if FAT_MIRROR_MODE == 1
+    if ((options & FatCache::CACHE_STATUS_DIRTY) && !mirrorDirty(blockNumber)) {
+      return 0;
+    }
+#endif  // FAT_MIRROR_MODE == 1
+    return cacheFetchData(blockNumber, options | FAT_CACHE_MIRROR);
+  }
+  bool cacheSyncFat() {
+    return m_cache.sync();
   }
   bool cacheSync() {
 
@@ -347,7 +706,7 @@ class FatVolume {
     // }
     // #endif
 
-    return m_cache.sync() && syncBlocks();
+    return m_cache.sync() && mirrorSync() && fsInfoSync() && syncBlocks();
   }
 #endif  // USE_SEPARATE_FAT_CACHE
   cache_t* cacheFetchData(uint32_t blockNumber, uint8_t options) {
@@ -356,9 +715,18 @@ class FatVolume {
   void cacheInvalidate() {
     m_cache.invalidate();
   }
+  void cacheInvalidate(uint32_t first, size_t count) {
+    m_cache.invalidate(first, count);
+  }
+  bool cacheIsCached(uint32_t blockNumber) {
+    return m_cache.isCached(blockNumber);
+  }
   bool cacheSyncData() {
     return m_cache.sync();
   }
+  bool cacheSyncData(uint32_t first, size_t count) {
+    return m_cache.sync(first, count);
+  }
   cache_t *cacheAddress() {
     return m_cache.block();
   }
@@ -212,6 +212,9 @@ int StdioStream::fseek(int32_t offset, int origin) {
   }
   m_r = 0;
   m_p = m_buf;
+  if (m_flags & F_SWR) {
+    m_w = writeSpace();
+  }
   return 0;
 
 fail:
@@ -489,16 +492,17 @@ bool StdioStream::flushBuf() {
     m_flags &= ~F_SRD;
     m_flags |= F_SWR;
     m_r = 0;
-    m_w = sizeof(m_buf);
+    m_w = writeSpace();
     m_p = m_buf;
     return true;
   }
-  uint8_t n = m_p - m_buf;
+  uint16_t n = m_p - m_buf;
   m_p = m_buf;
-  m_w = sizeof(m_buf);
   if (FatFile::write(m_buf, n) == n) {
+    m_w = writeSpace();
     return true;
   }
+  m_w = sizeof(m_buf);
   m_flags |= F_ERR;
   return false;
 }
@@ -511,6 +515,22 @@ int StdioStream::flushPut(uint8_t c) {
   return *m_p++ = c;
 }
 //------------------------------------------------------------------------------
+// private
+uint16_t StdioStream::writeSpace() {
+#if STDIO_STREAM_BUF_SIZE % 512 == 0
+  // End the next flush on a block boundary so FatFile::write() writes
+  // whole blocks to the device instead of through the cache.
+  uint16_t space = sizeof(m_buf) - (FatFile::curPosition() & 0X1FF);
+  if (space < 16) {
+    // Leave room for formatted output and realign in two flushes.
+    space += 256;
+  }
+  return space;
+#else  // STDIO_STREAM_BUF_SIZE % 512 == 0
+  return sizeof(m_buf);
+#endif  // STDIO_STREAM_BUF_SIZE % 512 == 0
+}
+//------------------------------------------------------------------------------
 char* StdioStream::fmtSpace(uint8_t len) {
   if (m_w < len) {
     if (!flushBuf() || m_w < len) {
@@ -31,10 +31,13 @@
 #include <limits.h>
 #include "FatFile.h"
 //------------------------------------------------------------------------------
+#if STDIO_STREAM_BUF_SIZE < 16 || STDIO_STREAM_BUF_SIZE > 65535
+#error STDIO_STREAM_BUF_SIZE must be 16 to 65535
+#endif  // STDIO_STREAM_BUF_SIZE
 /** Total size of stream buffer. The entire buffer is used for output.
   * During input UNGETC_BUF_SIZE of this space is reserved for ungetc.
   */
-const uint8_t STREAM_BUF_SIZE = 64;
+const uint16_t STREAM_BUF_SIZE = STDIO_STREAM_BUF_SIZE;
 /** Amount of buffer allocated for ungetc during input. */
 const uint8_t UNGETC_BUF_SIZE = 2;
 //------------------------------------------------------------------------------
@@ -647,6 +650,7 @@ class StdioStream : private FatFile {
   int fillGet();
   bool flushBuf();
   int flushPut(uint8_t c);
+  uint16_t writeSpace();
   char* fmtSpace(uint8_t len);
   int write(const void* buf, size_t count);
   //----------------------------------------------------------------------------
@@ -659,8 +663,8 @@ class StdioStream : private FatFile {
   //----------------------------------------------------------------------------
   uint8_t  m_flags;
   uint8_t* m_p;
-  uint8_t  m_r;
-  uint8_t  m_w;
+  uint16_t m_r;
+  uint16_t m_w;
   uint8_t  m_buf[STREAM_BUF_SIZE];
 };
 //------------------------------------------------------------------------------
@@ -367,15 +367,15 @@ template <typename T>
 void istream::getNumber(T* value) {
   uint32_t tmp;
   if ((T)-1 < 0) {
-    // number is signed, max positive value
-    uint32_t const m = ((uint32_t)-1) >> (33 - sizeof(T) * 8);
+    // number is signed, max positive value (at most 32 bits are parsed)
+    uint32_t const m = ((uint32_t)-1) >> (sizeof(T) < 4 ? 33 - sizeof(T) * 8 : 1);
     // max absolute value of negative number is m + 1.
     if (getNumber(m, m + 1, &tmp)) {
       *value = (T)tmp;
     }
   } else {
     // max unsigned value for T
-    uint32_t const m = (T)-1;
+    uint32_t const m = sizeof(T) < 4 ? (uint32_t)(T)-1 : (uint32_t)-1;
     if (getNumber(m, m, &tmp)) {
       *value = (T)tmp;
     }
@@ -0,0 +1,91 @@
+/**
+ * Copyright (c) 20011-2017 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include "SdImageCard.h"
+#if ENABLE_IMAGE_CARD_CLASS
+//------------------------------------------------------------------------------
+bool SdImageCard::begin(const char* path) {
+  long size;
+  end();
+  m_file = fopen(path, "r+b");
+  if (!m_file || fseek(m_file, 0, SEEK_END) || (size = ftell(m_file)) < 512) {
+    m_errorCode = SD_CARD_ERROR_CMD0;
+    goto fail;
+  }
+  m_blockCount = size >> 9;
+  m_errorCode = SD_CARD_ERROR_NONE;
+  resetCounters();
+  return true;
+
+fail:
+  end();
+  return false;
+}
+//------------------------------------------------------------------------------
+void SdImageCard::end() {
+  if (m_file) {
+    fclose(m_file);
+    m_file = 0;
+  }
+  m_blockCount = 0;
+}
+//------------------------------------------------------------------------------
+bool SdImageCard::readBlock(uint32_t block, uint8_t* dst) {
+  return readBlocks(block, dst, 1);
+}
+//------------------------------------------------------------------------------
+bool SdImageCard::readBlocks(uint32_t block, uint8_t* dst, size_t nb) {
+  m_readCommandCount++;
+  if (!seek(block, nb) || fread(dst, 512, nb, m_file) != nb) {
+    m_errorCode = nb == 1 ? SD_CARD_ERROR_CMD17 : SD_CARD_ERROR_CMD18;
+    return false;
+  }
+  m_readBlockCount += nb;
+  return true;
+}
+//------------------------------------------------------------------------------
+bool SdImageCard::seek(uint32_t block, size_t nb) {
+  return m_file && block < m_blockCount && nb <= m_blockCount - block &&
+         !fseek(m_file, (long)block << 9, SEEK_SET);
+}
+//------------------------------------------------------------------------------
+bool SdImageCard::syncBlocks() {
+  m_syncCount++;
+  return m_file && !fflush(m_file);
+}
+//------------------------------------------------------------------------------
+bool SdImageCard::writeBlock(uint32_t block, const uint8_t* src) {
+  return writeBlocks(block, src, 1);
+}
+//------------------------------------------------------------------------------
+bool SdImageCard::writeBlocks(uint32_t block, const uint8_t* src, size_t nb) {
+  m_writeCommandCount++;
+  if (!seek(block, nb) || fwrite(src, 512, nb, m_file) != nb) {
+    m_errorCode = nb == 1 ? SD_CARD_ERROR_CMD24 : SD_CARD_ERROR_CMD25;
+    return false;
+  }
+  m_writeBlockCount += nb;
+  return true;
+}
+#endif  // ENABLE_IMAGE_CARD_CLASS
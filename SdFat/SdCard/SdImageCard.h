@@ -0,0 +1,158 @@
+/**
+ * Copyright (c) 20011-2017 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SdImageCard_h
+#define SdImageCard_h
+/**
+ * \file
+ * \brief Block driver for a FAT volume image file.
+ */
+#include <stdio.h>
+#include "../SysCall.h"
+#include "../BlockDriver.h"
+#include "SdInfo.h"
+#if ENABLE_IMAGE_CARD_CLASS || defined(DOXYGEN)
+/**
+ * \class SdImageCard
+ * \brief Block access to an image of an SD card in a host file.
+ *
+ * Used to run FatLib on a host with a copy of a card.  The driver counts
+ * device commands and blocks so the I/O cost of an operation can be
+ * measured without hardware.
+ */
+class SdImageCard : public BaseBlockDriver {
+ public:
+  /** Construct an instance of SdImageCard. */
+  SdImageCard() : m_file(0), m_blockCount(0),
+    m_errorCode(SD_CARD_ERROR_INIT_NOT_CALLED) {
+    resetCounters();
+  }
+  /** Open an image file.
+   * \param[in] path Image file name.
+   * \return true for success else false.
+   */
+  bool begin(const char* path);
+  /** \return The number of 512 byte blocks in the image. */
+  uint32_t cardSize() {
+    return m_blockCount;
+  }
+  /** Close the image file. */
+  void end();
+  /** \return error code. */
+  uint8_t errorCode() const {
+    return m_errorCode;
+  }
+  /** \return error data. */
+  uint32_t errorData() const {
+    return 0;
+  }
+  /** \return card type. */
+  uint8_t type() const {
+    return SD_CARD_TYPE_SDHC;
+  }
+  /** \return Number of read commands. */
+  uint32_t readCommandCount() const {
+    return m_readCommandCount;
+  }
+  /** \return Number of blocks read. */
+  uint32_t readBlockCount() const {
+    return m_readBlockCount;
+  }
+  /** \return Number of write commands. */
+  uint32_t writeCommandCount() const {
+    return m_writeCommandCount;
+  }
+  /** \return Number of blocks written. */
+  uint32_t writeBlockCount() const {
+    return m_writeBlockCount;
+  }
+  /** \return Number of syncBlocks() calls. */
+  uint32_t syncCount() const {
+    return m_syncCount;
+  }
+  /** Zero the command and block counters. */
+  void resetCounters() {
+    m_readCommandCount = 0;
+    m_readBlockCount = 0;
+    m_writeCommandCount = 0;
+    m_writeBlockCount = 0;
+    m_syncCount = 0;
+  }
+  /**
+   * Read a 512 byte block from the image.
+   *
+   * \param[in] block Logical block to be read.
+   * \param[out] dst Pointer to the location that will receive the data.
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool readBlock(uint32_t block, uint8_t* dst);
+  /**
+   * Read multiple 512 byte blocks from the image.
+   *
+   * \param[in] block Logical block to be read.
+   * \param[in] nb Number of blocks to be read.
+   * \param[out] dst Pointer to the location that will receive the data.
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool readBlocks(uint32_t block, uint8_t* dst, size_t nb);
+  /** Flush buffered writes to the image file.
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool syncBlocks();
+  /**
+   * Writes a 512 byte block to the image.
+   *
+   * \param[in] block Logical block to be written.
+   * \param[in] src Pointer to the location of the data to be written.
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool writeBlock(uint32_t block, const uint8_t* src);
+  /**
+   * Write multiple 512 byte blocks to the image.
+   *
+   * \param[in] block Logical block to be written.
+   * \param[in] nb Number of blocks to be written.
+   * \param[in] src Pointer to the location of the data to be written.
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool writeBlocks(uint32_t block, const uint8_t* src, size_t nb);
+
+ private:
+  bool seek(uint32_t block, size_t nb);
+  FILE* m_file;
+  uint32_t m_blockCount;
+  uint8_t m_errorCode;
+  uint32_t m_readCommandCount;
+  uint32_t m_readBlockCount;
+  uint32_t m_writeCommandCount;
+  uint32_t m_writeBlockCount;
+  uint32_t m_syncCount;
+};
+#endif  // ENABLE_IMAGE_CARD_CLASS || defined(DOXYGEN)
+#endif  // SdImageCard_h
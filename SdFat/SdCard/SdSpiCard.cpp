@@ -23,6 +23,8 @@
  * DEALINGS IN THE SOFTWARE.
  */
 #include "SdSpiCard.h"
+// compute the CRC while DMA moves the data
+#define SD_CRC_OVERLAP (USE_SD_CRC && SD_CRC_CHUNK_SIZE && SD_SPI_ASYNC_TRANSFER)
 // debug trace macro
 #define SD_TRACE(m, b)
 // #define SD_TRACE(m, b) Serial.print(m);Serial.println(b);
@@ -50,8 +52,7 @@ static uint8_t CRC7(const uint8_t* data, uint8_t n) {
 #if USE_SD_CRC == 1
 // Shift based CRC-CCITT
 // uses the x^16,x^12,x^5,x^1 polynomial.
-static uint16_t CRC_CCITT(const uint8_t *data, size_t n) {
-  uint16_t crc = 0;
+static uint16_t CRC_CCITT(const uint8_t *data, size_t n, uint16_t crc = 0) {
   for (size_t i = 0; i < n; i++) {
     crc = (uint8_t)(crc >> 8) | (crc << 8);
     crc ^= data[i];
@@ -61,15 +62,11 @@ static uint16_t CRC_CCITT(const uint8_t *data, size_t n) {
   }
   return crc;
 }
-#elif USE_SD_CRC > 1  // CRC_CCITT
+#elif USE_SD_CRC > 1 && defined(__AVR__)  // CRC_CCITT
 //------------------------------------------------------------------------------
 // Table based CRC-CCITT
 // uses the x^16,x^12,x^5,x^1 polynomial.
-#ifdef __AVR__
 static const uint16_t crctab[] PROGMEM = {
-#else  // __AVR__
-static const uint16_t crctab[] = {
-#endif  // __AVR__
   0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
   0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
   0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
@@ -103,14 +100,62 @@ static const uint16_t crctab[] = {
   0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
   0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
 };
-static uint16_t CRC_CCITT(const uint8_t* data, size_t n) {
-  uint16_t crc = 0;
+static uint16_t CRC_CCITT(const uint8_t* data, size_t n, uint16_t crc = 0) {
   for (size_t i = 0; i < n; i++) {
-#ifdef __AVR__
     crc = pgm_read_word(&crctab[(crc >> 8 ^ data[i]) & 0XFF]) ^ (crc << 8);
-#else  // __AVR__
+  }
+  return crc;
+}
+#elif USE_SD_CRC > 1  // CRC_CCITT
+//------------------------------------------------------------------------------
+// Table based CRC-CCITT with tables generated at compile time.
+// uses the x^16,x^12,x^5,x^1 polynomial.
+//
+// crcShift() feeds k zero bits through the CRC register.  Entry v of
+// table k is the CRC of byte v followed by k zero bytes.
+constexpr uint16_t crcShift(uint16_t crc, uint8_t k) {
+  return k == 0 ? crc : crcShift((uint16_t)(crc & 0X8000 ?
+                        (crc << 1) ^ 0X1021 : crc << 1), k - 1);
+}
+constexpr uint16_t crcEntry(uint8_t k, uint16_t v) {
+  return k == 0 ? crcShift(v << 8, 8) :
+         (uint16_t)(crcEntry(k - 1, v) << 8) ^
+         crcEntry(0, crcEntry(k - 1, v) >> 8);
+}
+// Index list 0, 1, ..., 255 used to fill a table.
+template<uint16_t... I> struct CrcIndex {};
+template<uint16_t N, uint16_t... I>
+struct CrcMakeIndex : CrcMakeIndex<N - 1, N - 1, I...> {};
+template<uint16_t... I> struct CrcMakeIndex<0, I...> {
+  typedef CrcIndex<I...> type;
+};
+template<uint8_t K, typename T> struct CrcTable;
+template<uint8_t K, uint16_t... I> struct CrcTable<K, CrcIndex<I...> > {
+  static const uint16_t table[sizeof...(I)];
+};
+template<uint8_t K, uint16_t... I>
+const uint16_t CrcTable<K, CrcIndex<I...> >::table[sizeof...(I)] = {
+  crcEntry(K, I)...
+};
+typedef CrcMakeIndex<256>::type CrcIndex256;
+static const uint16_t* const crctab = CrcTable<0, CrcIndex256>::table;
+#if USE_SD_CRC > 2
+static const uint16_t* const crctab1 = CrcTable<1, CrcIndex256>::table;
+static const uint16_t* const crctab2 = CrcTable<2, CrcIndex256>::table;
+static const uint16_t* const crctab3 = CrcTable<3, CrcIndex256>::table;
+#endif  // USE_SD_CRC > 2
+static uint16_t CRC_CCITT(const uint8_t* data, size_t n, uint16_t crc = 0) {
+  size_t i = 0;
+#if USE_SD_CRC > 2
+  // Slice-by-4, the CRC is folded into the first two bytes of each step.
+  for (; i + 4 <= n; i += 4) {
+    crc = crctab3[(crc >> 8 ^ data[i]) & 0XFF] ^
+          crctab2[(crc ^ data[i + 1]) & 0XFF] ^
+          crctab1[data[i + 2]] ^ crctab[data[i + 3]];
+  }
+#endif  // USE_SD_CRC > 2
+  for (; i < n; i++) {
     crc = crctab[(crc >> 8 ^ data[i]) & 0XFF] ^ (crc << 8);
-#endif  // __AVR__
   }
   return crc;
 }
@@ -119,13 +164,24 @@ static uint16_t CRC_CCITT(const uint8_t* data, size_t n) {
 //==============================================================================
 // SdSpiCard member functions
 //------------------------------------------------------------------------------
+#if USE_SD_YIELD_CALLBACK
+SdYieldCallback_t SdSpiCard::m_yieldCallback = 0;
+#endif  // USE_SD_YIELD_CALLBACK
+//------------------------------------------------------------------------------
 bool SdSpiCard::begin(SdSpiDriver* spi, uint8_t csPin, SPISettings settings) {
   m_spiActive = false;
   m_errorCode = SD_CARD_ERROR_NONE;
+#if USE_ASYNC_BLOCK_IO
+  m_asyncState = ASYNC_IDLE;
+#endif  // USE_ASYNC_BLOCK_IO
   m_type = 0;
   m_spiDriver = spi;
   uint16_t t0 = curTimeMS();
   uint32_t arg;
+#if USE_SD_YIELD_CALLBACK
+  uint32_t m0 = micros();
+  resetWaitCounters();
+#endif  // USE_SD_YIELD_CALLBACK
 
   m_spiDriver->begin(csPin);
   m_spiDriver->setSpiSettings(SD_SCK_HZ(250000));
@@ -139,7 +195,7 @@ bool SdSpiCard::begin(SdSpiDriver* spi, uint8_t csPin, SPISettings settings) {
   spiSelect();
   // command to go idle in SPI mode
   while (cardCommand(CMD0, 0) != R1_IDLE_STATE) {
-    if (isTimedOut(t0, SD_INIT_TIMEOUT)) {
+    if (isTimedOut(t0, SD_INIT_TIMEOUT, WAIT_INIT)) {
       error(SD_CARD_ERROR_CMD0);
       goto fail;
     }
@@ -163,7 +219,7 @@ bool SdSpiCard::begin(SdSpiDriver* spi, uint8_t csPin, SPISettings settings) {
       type(SD_CARD_TYPE_SD2);
       break;
     }
-    if (isTimedOut(t0, SD_INIT_TIMEOUT)) {
+    if (isTimedOut(t0, SD_INIT_TIMEOUT, WAIT_INIT)) {
       error(SD_CARD_ERROR_CMD8);
       goto fail;
     }
@@ -173,7 +229,7 @@ bool SdSpiCard::begin(SdSpiDriver* spi, uint8_t csPin, SPISettings settings) {
 
   while (cardAcmd(ACMD41, arg) != R1_READY_STATE) {
     // check for timeout
-    if (isTimedOut(t0, SD_INIT_TIMEOUT)) {
+    if (isTimedOut(t0, SD_INIT_TIMEOUT, WAIT_INIT)) {
       error(SD_CARD_ERROR_ACMD41);
       goto fail;
     }
@@ -194,6 +250,9 @@ bool SdSpiCard::begin(SdSpiDriver* spi, uint8_t csPin, SPISettings settings) {
   }
   spiStop();
   m_spiDriver->setSpiSettings(settings);
+#if USE_SD_YIELD_CALLBACK
+  waitDone(WAIT_INIT, m0);
+#endif  // USE_SD_YIELD_CALLBACK
   return true;
 
 fail:
@@ -203,12 +262,24 @@ fail:
 //------------------------------------------------------------------------------
 // send command and return error code.  Return zero for OK
 uint8_t SdSpiCard::cardCommand(uint8_t cmd, uint32_t arg) {
+#if USE_ASYNC_BLOCK_IO
+  // finish and check a writeBlockStart() so its error isn't lost
+  if (m_asyncState == ASYNC_WRITE && !writeStartDone()) {
+    return 0XFF;
+  }
+  // finish a readBlocksStart() so the command isn't sent mid-block
+  while (m_asyncState == ASYNC_READ) {
+    if (poll() < 0) {
+      return 0XFF;
+    }
+  }
+#endif  // USE_ASYNC_BLOCK_IO
   // select card
   if (!m_spiActive) {
     spiStart();
   }
   // wait if busy
-  waitNotBusy(SD_WRITE_TIMEOUT);
+  waitNotBusy(SD_WRITE_TIMEOUT, WAIT_COMMAND);
 
 #if USE_SD_CRC
   // form message
@@ -279,7 +350,7 @@ bool SdSpiCard::erase(uint32_t firstBlock, uint32_t lastBlock) {
     error(SD_CARD_ERROR_ERASE);
     goto fail;
   }
-  if (!waitNotBusy(SD_ERASE_TIMEOUT)) {
+  if (!waitNotBusy(SD_ERASE_TIMEOUT, WAIT_ERASE)) {
     error(SD_CARD_ERROR_ERASE_TIMEOUT);
     goto fail;
   }
@@ -314,7 +385,66 @@ bool SdSpiCard::isBusy() {
   return rtn;
 }
 //------------------------------------------------------------------------------
-bool SdSpiCard::isTimedOut(uint16_t startMS, uint16_t timeoutMS) {
+#if USE_ASYNC_BLOCK_IO
+int8_t SdSpiCard::poll() {
+  if (m_asyncState == ASYNC_WRITE) {
+    spiStart();
+    if (spiReceive() != 0XFF) {
+      if (isTimedOut(m_asyncT0, SD_WRITE_TIMEOUT, WAIT_PROGRAM)) {
+        error(SD_CARD_ERROR_WRITE_TIMEOUT);
+        goto fail;
+      }
+      spiStop();
+      return 0;
+    }
+    m_asyncState = ASYNC_IDLE;
+#if CHECK_FLASH_PROGRAMMING
+    // response is r2 so get and check two bytes for nonzero
+    if (cardCommand(CMD13, 0) || spiReceive()) {
+      error(SD_CARD_ERROR_CMD13);
+      goto fail;
+    }
+#endif  // CHECK_FLASH_PROGRAMMING
+    spiStop();
+  } else if (m_asyncState == ASYNC_READ) {
+    // check for start block token
+    if ((m_status = spiReceive()) == 0XFF) {
+      if (isTimedOut(m_asyncT0, SD_READ_TIMEOUT, WAIT_READ_TOKEN)) {
+        error(SD_CARD_ERROR_READ_TIMEOUT);
+        goto fail;
+      }
+      return 0;
+    }
+    if (m_status != DATA_START_BLOCK) {
+      error(SD_CARD_ERROR_READ);
+      goto fail;
+    }
+    if (!readDataBlock(m_asyncDst, 512)) {
+      goto fail;
+    }
+    m_asyncDst += 512;
+    m_asyncT0 = curTimeMS();
+    if (--m_asyncCount) {
+      return 0;
+    }
+    // idle first, readStop() sends CMD12 through cardCommand()
+    m_asyncState = ASYNC_IDLE;
+    if (!readStop()) {
+      goto fail;
+    }
+  }
+  m_asyncState = ASYNC_IDLE;
+  return 1;
+
+fail:
+  m_asyncState = ASYNC_IDLE;
+  spiStop();
+  return -1;
+}
+#endif  // USE_ASYNC_BLOCK_IO
+//------------------------------------------------------------------------------
+bool SdSpiCard::isTimedOut(uint16_t startMS, uint16_t timeoutMS,
+                           uint8_t reason) {
 #if WDT_YIELD_TIME_MICROS
   static uint32_t last;
   if ((micros() - last) > WDT_YIELD_TIME_MICROS) {
@@ -322,6 +452,16 @@ bool SdSpiCard::isTimedOut(uint16_t startMS, uint16_t timeoutMS) {
     last = micros();
   }
 #endif  // WDT_YIELD_TIME_MICROS
+#if USE_SD_YIELD_CALLBACK
+  static uint32_t lastCallback;
+  if (m_yieldCallback &&
+      (micros() - lastCallback) > SD_YIELD_CALLBACK_MICROS) {
+    m_yieldCallback(curTimeMS() - startMS, reason);
+    lastCallback = micros();
+  }
+#else  // USE_SD_YIELD_CALLBACK
+  (void)reason;
+#endif  // USE_SD_YIELD_CALLBACK
   return (curTimeMS() - startMS) > timeoutMS;
 }
 //------------------------------------------------------------------------------
@@ -358,36 +498,89 @@ bool SdSpiCard::readBlocks(uint32_t block, uint8_t* dst, size_t count) {
   return readStop();
 }
 //------------------------------------------------------------------------------
+#if USE_ASYNC_BLOCK_IO
+bool SdSpiCard::readBlocksStart(uint32_t lba, uint8_t* dst, size_t nb) {
+  if (nb == 0) {
+    return true;
+  }
+  if (!readStart(lba)) {
+    return false;
+  }
+  m_asyncDst = dst;
+  m_asyncCount = nb;
+  m_asyncT0 = curTimeMS();
+  m_asyncState = ASYNC_READ;
+  return true;
+}
+#endif  // USE_ASYNC_BLOCK_IO
+//------------------------------------------------------------------------------
 bool SdSpiCard::readData(uint8_t *dst) {
   return readData(dst, 512);
 }
 //------------------------------------------------------------------------------
 bool SdSpiCard::readData(uint8_t* dst, size_t count) {
-#if USE_SD_CRC
-  uint16_t crc;
-#endif  // USE_SD_CRC
   // wait for start block token
   uint16_t t0 = curTimeMS();
+#if USE_SD_YIELD_CALLBACK
+  uint32_t m0 = micros();
+#endif  // USE_SD_YIELD_CALLBACK
   while ((m_status = spiReceive()) == 0XFF) {
-    if (isTimedOut(t0, SD_READ_TIMEOUT)) {
+    if (isTimedOut(t0, SD_READ_TIMEOUT, WAIT_READ_TOKEN)) {
       error(SD_CARD_ERROR_READ_TIMEOUT);
       goto fail;
     }
   }
+#if USE_SD_YIELD_CALLBACK
+  waitDone(WAIT_READ_TOKEN, m0);
+#endif  // USE_SD_YIELD_CALLBACK
   if (m_status != DATA_START_BLOCK) {
     error(SD_CARD_ERROR_READ);
     goto fail;
   }
+  return readDataBlock(dst, count);
+
+fail:
+  spiStop();
+  return false;
+}
+//------------------------------------------------------------------------------
+// read data and crc that follow a start block token
+bool SdSpiCard::readDataBlock(uint8_t* dst, size_t count) {
+#if SD_CRC_OVERLAP
+  // receive the next chunk while the crc of the last one is computed
+  uint16_t crc = 0;
+  size_t n = count < SD_CRC_CHUNK_SIZE ? count : SD_CRC_CHUNK_SIZE;
+  spiReceiveStart(dst, n);
+  for (size_t i = 0; i < count;) {
+    spiTransferWait();
+    size_t next = i + n;
+    size_t m = count - next < SD_CRC_CHUNK_SIZE ? count - next
+                                                 : SD_CRC_CHUNK_SIZE;
+    if (m) {
+      spiReceiveStart(dst + next, m);
+    }
+    crc = CRC_CCITT(dst + i, n, crc);
+    i = next;
+    n = m;
+  }
+#else  // SD_CRC_OVERLAP
+#if USE_SD_CRC
+  uint16_t crc;
+#endif  // USE_SD_CRC
   // transfer data
   if ((m_status = spiReceive(dst, count))) {
     error(SD_CARD_ERROR_DMA);
     goto fail;
   }
-
+#endif  // SD_CRC_OVERLAP
 #if USE_SD_CRC
-  // get crc
-  crc = (spiReceive() << 8) | spiReceive();
-  if (crc != CRC_CCITT(dst, count)) {
+  // check crc, zero if it matches the card's crc
+#if !SD_CRC_OVERLAP
+  crc = CRC_CCITT(dst, count);
+#endif  // !SD_CRC_OVERLAP
+  crc ^= spiReceive() << 8;
+  crc ^= spiReceive();
+  if (crc) {
     error(SD_CARD_ERROR_READ_CRC);
     goto fail;
   }
@@ -504,26 +697,52 @@ fail:
 }
 //------------------------------------------------------------------------------
 // wait for card to go not busy
-bool SdSpiCard::waitNotBusy(uint16_t timeoutMS) {
+bool SdSpiCard::waitNotBusy(uint16_t timeoutMS, uint8_t reason) {
+  bool rtn = false;
   uint16_t t0 = curTimeMS();
+#if USE_SD_YIELD_CALLBACK
+  uint32_t m0 = micros();
+#endif  // USE_SD_YIELD_CALLBACK
 #if WDT_YIELD_TIME_MICROS
   // Call isTimedOut first to insure yield is called.
-  while (!isTimedOut(t0, timeoutMS)) {
+  while (!isTimedOut(t0, timeoutMS, reason)) {
     if (spiReceive() == 0XFF) {
-      return true;
+      rtn = true;
+      break;
     }
   }
-  return false;
 #else  // WDT_YIELD_TIME_MICROS
   // Check not busy first since yield is not called in isTimedOut.
+  rtn = true;
   while (spiReceive() != 0XFF) {
-    if (isTimedOut(t0, timeoutMS)) {
+    if (isTimedOut(t0, timeoutMS, reason)) {
+      rtn = false;
+      break;
+    }
+  }
+#endif  // WDT_YIELD_TIME_MICROS
+#if USE_SD_YIELD_CALLBACK
+  waitDone(reason, m0);
+#endif  // USE_SD_YIELD_CALLBACK
+  return rtn;
+}
+//------------------------------------------------------------------------------
+#if USE_ASYNC_BLOCK_IO
+bool SdSpiCard::syncBlocks() {
+  if (m_asyncState == ASYNC_WRITE) {
+    // the block isn't on the card until programming is done
+    bool rtn = writeStartDone();
+    spiStop();
+    return rtn;
+  }
+  while (m_asyncState == ASYNC_READ) {
+    if (poll() < 0) {
       return false;
     }
   }
   return true;
-#endif  // WDT_YIELD_TIME_MICROS
 }
+#endif  // USE_ASYNC_BLOCK_IO
 //------------------------------------------------------------------------------
 bool SdSpiCard::writeBlock(uint32_t blockNumber, const uint8_t* src) {
   SD_TRACE("WB", blockNumber);
@@ -542,7 +761,7 @@ bool SdSpiCard::writeBlock(uint32_t blockNumber, const uint8_t* src) {
 
 #if CHECK_FLASH_PROGRAMMING
   // wait for flash programming to complete
-  if (!waitNotBusy(SD_WRITE_TIMEOUT)) {
+  if (!waitNotBusy(SD_WRITE_TIMEOUT, WAIT_PROGRAM)) {
     error(SD_CARD_ERROR_WRITE_TIMEOUT);
     goto fail;
   }
@@ -561,6 +780,50 @@ fail:
   return false;
 }
 //------------------------------------------------------------------------------
+#if USE_ASYNC_BLOCK_IO
+bool SdSpiCard::writeBlockStart(uint32_t lba, const uint8_t* src) {
+  SD_TRACE("WBS", lba);
+  // use address if not SDHC card
+  if (type() != SD_CARD_TYPE_SDHC) {
+    lba <<= 9;
+  }
+  if (cardCommand(CMD24, lba)) {
+    error(SD_CARD_ERROR_CMD24);
+    goto fail;
+  }
+  if (!writeData(DATA_START_BLOCK, src)) {
+    goto fail;
+  }
+  // the card is programming, let poll() or the next command wait
+  m_asyncT0 = curTimeMS();
+  m_asyncState = ASYNC_WRITE;
+  spiStop();
+  return true;
+
+fail:
+  spiStop();
+  return false;
+}
+//------------------------------------------------------------------------------
+// wait for a writeBlockStart() to program and check the card status
+bool SdSpiCard::writeStartDone() {
+  m_asyncState = ASYNC_IDLE;
+  spiStart();
+  if (!waitNotBusy(SD_WRITE_TIMEOUT, WAIT_PROGRAM)) {
+    error(SD_CARD_ERROR_WRITE_TIMEOUT);
+    return false;
+  }
+#if CHECK_FLASH_PROGRAMMING
+  // response is r2 so get and check two bytes for nonzero
+  if (cardCommand(CMD13, 0) || spiReceive()) {
+    error(SD_CARD_ERROR_CMD13);
+    return false;
+  }
+#endif  // CHECK_FLASH_PROGRAMMING
+  return true;
+}
+#endif  // USE_ASYNC_BLOCK_IO
+//------------------------------------------------------------------------------
 bool SdSpiCard::writeBlocks(uint32_t block, const uint8_t* src, size_t count) {
   if (!writeStart(block)) {
     goto fail;
@@ -579,7 +842,7 @@ bool SdSpiCard::writeBlocks(uint32_t block, const uint8_t* src, size_t count) {
 //------------------------------------------------------------------------------
 bool SdSpiCard::writeData(const uint8_t* src) {
   // wait for previous write to finish
-  if (!waitNotBusy(SD_WRITE_TIMEOUT)) {
+  if (!waitNotBusy(SD_WRITE_TIMEOUT, WAIT_PROGRAM)) {
     error(SD_CARD_ERROR_WRITE_TIMEOUT);
     goto fail;
   }
@@ -595,6 +858,13 @@ fail:
 //------------------------------------------------------------------------------
 // send one block of data for write block or write multiple blocks
 bool SdSpiCard::writeData(uint8_t token, const uint8_t* src) {
+#if SD_CRC_OVERLAP
+  // the crc is only sent after the data, so compute it during the DMA
+  spiSend(token);
+  spiSendStart(src, 512);
+  uint16_t crc = CRC_CCITT(src, 512);
+  spiTransferWait();
+#else  // SD_CRC_OVERLAP
 #if USE_SD_CRC
   uint16_t crc = CRC_CCITT(src, 512);
 #else  // USE_SD_CRC
@@ -602,6 +872,7 @@ bool SdSpiCard::writeData(uint8_t token, const uint8_t* src) {
 #endif  // USE_SD_CRC
   spiSend(token);
   spiSend(src, 512);
+#endif  // SD_CRC_OVERLAP
   spiSend(crc >> 8);
   spiSend(crc & 0XFF);
 
@@ -656,7 +927,7 @@ fail:
 }
 //------------------------------------------------------------------------------
 bool SdSpiCard::writeStop() {
-  if (!waitNotBusy(SD_WRITE_TIMEOUT)) {
+  if (!waitNotBusy(SD_WRITE_TIMEOUT, WAIT_PROGRAM)) {
     goto fail;
   }
   spiSend(STOP_TRAN_TOKEN);
@@ -29,21 +29,39 @@
  * \brief SdSpiCard class for V2 SD/SDHC cards
  */
 #include <stddef.h>
+#include <string.h>
 #include "../SysCall.h"
 #include "SdInfo.h"
 #include "../FatLib/BaseBlockDriver.h"
+#if USE_SD_YIELD_CALLBACK
+/** Type of the SdSpiCard yield callback, elapsed milliseconds and reason. */
+typedef void (*SdYieldCallback_t)(uint16_t elapsedMS, uint8_t reason);
+#endif  // USE_SD_YIELD_CALLBACK
 #include "../SpiDriver/SdSpiDriver.h"
 //==============================================================================
 /**
  * \class SdSpiCard
  * \brief Raw access to SD and SDHC flash memory cards via SPI protocol.
  */
-#if ENABLE_EXTENDED_TRANSFER_CLASS || ENABLE_SDIO_CLASS
+#if ENABLE_EXTENDED_TRANSFER_CLASS || ENABLE_SDIO_CLASS || \
+    ENABLE_IMAGE_CARD_CLASS || ENABLE_TIMING_CARD_CLASS
 class SdSpiCard : public BaseBlockDriver {
-#else  // ENABLE_EXTENDED_TRANSFER_CLASS || ENABLE_SDIO_CLASS
+#else  // ENABLE_EXTENDED_TRANSFER_CLASS || ENABLE_SDIO_CLASS ...
 class SdSpiCard {
-#endif  // ENABLE_EXTENDED_TRANSFER_CLASS || ENABLE_SDIO_CLASS
+#endif  // ENABLE_EXTENDED_TRANSFER_CLASS || ENABLE_SDIO_CLASS ...
  public:
+  /** Wait for the card to be ready for a command. */
+  static const uint8_t WAIT_COMMAND = 0;
+  /** Wait for the card to program written data. */
+  static const uint8_t WAIT_PROGRAM = 1;
+  /** Wait for an erase to finish. */
+  static const uint8_t WAIT_ERASE = 2;
+  /** Wait for the start token of a data block. */
+  static const uint8_t WAIT_READ_TOKEN = 3;
+  /** Wait for the card to initialize in begin(). */
+  static const uint8_t WAIT_INIT = 4;
+  /** Number of wait reasons. */
+  static const uint8_t WAIT_REASON_COUNT = 5;
   /** Construct an instance of SdSpiCard. */
   SdSpiCard() : m_errorCode(SD_CARD_ERROR_INIT_NOT_CALLED), m_type(0) {}
   /** Initialize the SD card.
@@ -103,6 +121,45 @@ class SdSpiCard {
    * \return true if busy else false.
    */
   bool isBusy();
+#if USE_SD_YIELD_CALLBACK
+  /** Zero the wait counters. */
+  void resetWaitCounters() {
+    memset(m_waitCount, 0, sizeof(m_waitCount));
+    memset(m_waitMicros, 0, sizeof(m_waitMicros));
+  }
+  /** \return Number of waits for a reason.
+   * \param[in] reason WAIT_COMMAND through WAIT_INIT.
+   */
+  uint32_t waitCount(uint8_t reason) const {
+    return reason < WAIT_REASON_COUNT ? m_waitCount[reason] : 0;
+  }
+  /** \return Total microseconds spent in waits for a reason.
+   * \param[in] reason WAIT_COMMAND through WAIT_INIT.
+   */
+  uint32_t waitMicros(uint8_t reason) const {
+    return reason < WAIT_REASON_COUNT ? m_waitMicros[reason] : 0;
+  }
+  /** Set the function called from wait loops.
+   *
+   * \param[in] callback The user's function or zero to cancel.
+   * It is called with the milliseconds spent in the current wait and the
+   * wait reason.  It must not access the card.
+   */
+  static void yieldCallback(SdYieldCallback_t callback) {
+    m_yieldCallback = callback;
+  }
+#endif  // USE_SD_YIELD_CALLBACK
+#if USE_ASYNC_BLOCK_IO
+  /**
+   * Advance a writeBlockStart() or readBlocksStart() operation without
+   * waiting.  A busy write is checked with CS high between calls.  A read
+   * keeps the card selected and takes one block per call when it is ready.
+   *
+   * \return one if no operation is in progress, zero if the operation is
+   * not done, or minus one for an error.
+   */
+  int8_t poll();
+#endif  // USE_ASYNC_BLOCK_IO
   /**
    * Read a 512 byte block from an SD card.
    *
@@ -122,6 +179,19 @@ class SdSpiCard {
    * the value false is returned for failure.
    */
   bool readBlocks(uint32_t lba, uint8_t* dst, size_t nb);
+#if USE_ASYNC_BLOCK_IO
+  /**
+   * Start a multiple block read that is finished by calls to poll().
+   * No other card call may be made until poll() returns nonzero.
+   *
+   * \param[in] lba Logical block to be read.
+   * \param[in] nb Number of blocks to be read.
+   * \param[out] dst Pointer to the location that will receive the data.
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool readBlocksStart(uint32_t lba, uint8_t* dst, size_t nb);
+#endif  // USE_ASYNC_BLOCK_IO
   /**
    * Read a card's CID register. The CID contains card identification
    * information such as Manufacturer ID, Product name, Product serial
@@ -182,8 +252,15 @@ class SdSpiCard {
    * the value false is returned for failure.
    */
   bool readStop();
+#if USE_ASYNC_BLOCK_IO
+  /** Wait for a writeBlockStart() or readBlocksStart() to finish.
+   * \return success if sync successful. Not for user apps.
+   */
+  bool syncBlocks();
+#else  // USE_ASYNC_BLOCK_IO
   /** \return success if sync successful. Not for user apps. */
   bool syncBlocks() {return true;}
+#endif  // USE_ASYNC_BLOCK_IO
   /** Return the card type: SD V1, SD V2 or SDHC
    * \return 0 - SD V1, 1 - SD V2, or 3 - SDHC.
    */
@@ -199,6 +276,20 @@ class SdSpiCard {
    * the value false is returned for failure.
    */
   bool writeBlock(uint32_t lba, const uint8_t* src);
+#if USE_ASYNC_BLOCK_IO
+  /**
+   * Write a 512 byte block without waiting for flash programming.  The
+   * next command waits for the card or poll() reports when it is done.
+   * With CHECK_FLASH_PROGRAMMING the card status is then checked and a
+   * failed write fails that next call.
+   *
+   * \param[in] lba Logical block to be written.
+   * \param[in] src Pointer to the location of the data to be written.
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool writeBlockStart(uint32_t lba, const uint8_t* src);
+#endif  // USE_ASYNC_BLOCK_IO
   /**
    * Write multiple 512 byte blocks to an SD card.
    *
@@ -245,9 +336,9 @@ class SdSpiCard {
    * the value false is returned for failure.
    */
   bool writeStop();
-  /** Set CS low and activate the card. */
+  /** Take the SPI bus, set CS low and activate the card. */
   void spiStart();
-  /** Set CS high and deactivate the card. */
+  /** Set CS high, deactivate the card and release the SPI bus. */
   void spiStop();
 
  private:
@@ -257,16 +348,20 @@ class SdSpiCard {
     return cardCommand(cmd, arg);
   }
   uint8_t cardCommand(uint8_t cmd, uint32_t arg);
-  bool isTimedOut(uint16_t startMS, uint16_t timeoutMS);
+  bool isTimedOut(uint16_t startMS, uint16_t timeoutMS, uint8_t reason);
   bool readData(uint8_t* dst, size_t count);
+  bool readDataBlock(uint8_t* dst, size_t count);
   bool readRegister(uint8_t cmd, void* buf);
 
   void type(uint8_t value) {
     m_type = value;
   }
 
-  bool waitNotBusy(uint16_t timeoutMS);
+  bool waitNotBusy(uint16_t timeoutMS, uint8_t reason);
   bool writeData(uint8_t token, const uint8_t* src);
+#if USE_ASYNC_BLOCK_IO
+  bool writeStartDone();
+#endif  // USE_ASYNC_BLOCK_IO
 
   //---------------------------------------------------------------------------
   // functions defined in SdSpiDriver.h
@@ -288,12 +383,41 @@ class SdSpiCard {
   void spiSend(const uint8_t* buf, size_t n) {
     m_spiDriver->send(buf, n);
   }
+#if SD_SPI_ASYNC_TRANSFER
+  void spiReceiveStart(uint8_t* buf, size_t n) {
+    m_spiDriver->receiveStart(buf, n);
+  }
+  void spiSendStart(const uint8_t* buf, size_t n) {
+    m_spiDriver->sendStart(buf, n);
+  }
+  void spiTransferWait() {
+    m_spiDriver->transferWait();
+  }
+#endif  // SD_SPI_ASYNC_TRANSFER
   void spiSelect() {
     m_spiDriver->select();
   }
   void spiUnselect() {
     m_spiDriver->unselect();
   }
+#if USE_ASYNC_BLOCK_IO
+  static const uint8_t ASYNC_IDLE = 0;
+  static const uint8_t ASYNC_WRITE = 1;
+  static const uint8_t ASYNC_READ = 2;
+  uint8_t* m_asyncDst;
+  size_t m_asyncCount;
+  uint16_t m_asyncT0;
+  uint8_t m_asyncState;
+#endif  // USE_ASYNC_BLOCK_IO
+#if USE_SD_YIELD_CALLBACK
+  static SdYieldCallback_t m_yieldCallback;
+  uint32_t m_waitCount[WAIT_REASON_COUNT];
+  uint32_t m_waitMicros[WAIT_REASON_COUNT];
+  void waitDone(uint8_t reason, uint32_t startMicros) {
+    m_waitCount[reason]++;
+    m_waitMicros[reason] += micros() - startMicros;
+  }
+#endif  // USE_SD_YIELD_CALLBACK
   uint8_t m_errorCode;
   SdSpiDriver *m_spiDriver;
   bool    m_spiActive;
@@ -317,8 +441,20 @@ class SdSpiCardEX : public SdSpiCard {
    */
   bool begin(SdSpiDriver* spi, uint8_t csPin, SPISettings spiSettings) {
     m_curState = IDLE_STATE;
+    m_commandCount = 0;
+    m_savedCommandCount = 0;
     return SdSpiCard::begin(spi, csPin, spiSettings);
   }
+  /** \return Number of multi-block read and write transactions started. */
+  uint32_t commandCount() const {
+    return m_commandCount;
+  }
+  /** \return Number of calls that continued an open transaction instead of
+   *  starting a new one.
+   */
+  uint32_t savedCommandCount() const {
+    return m_savedCommandCount;
+  }
   /**
    * Read a 512 byte block from an SD card.
    *
@@ -362,11 +498,46 @@ class SdSpiCardEX : public SdSpiCard {
    * the value false is returned for failure.
    */
   bool writeBlocks(uint32_t block, const uint8_t* src, size_t nb);
+#if USE_ASYNC_BLOCK_IO
+  /** Transfers stay in the open multi-block transaction.
+   * \return Always one, no operation is left in progress.
+   */
+  int8_t poll() {
+    return 1;
+  }
+  /**
+   * Read multiple blocks in the open transaction.
+   *
+   * \param[in] block Logical block to be read.
+   * \param[in] nb Number of blocks to be read.
+   * \param[out] dst Pointer to the location that will receive the data.
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool readBlocksStart(uint32_t block, uint8_t* dst, size_t nb) {
+    return readBlocks(block, dst, nb);
+  }
+  /**
+   * Write a block in the open transaction.
+   *
+   * \param[in] block Logical block to be written.
+   * \param[in] src Pointer to the location of the data to be written.
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool writeBlockStart(uint32_t block, const uint8_t* src) {
+    return writeBlock(block, src);
+  }
+#endif  // USE_ASYNC_BLOCK_IO
 
  private:
   static const uint32_t IDLE_STATE = 0;
   static const uint32_t READ_STATE = 1;
   static const uint32_t WRITE_STATE = 2;
+  bool readContinue(uint32_t block);
+  bool writeContinue(uint32_t block, size_t nb);
+  uint32_t m_commandCount;
+  uint32_t m_savedCommandCount;
   uint32_t m_curBlock;
   uint8_t m_curState;
 };
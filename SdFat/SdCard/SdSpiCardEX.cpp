@@ -24,15 +24,8 @@
  */
 #include "SdSpiCard.h"
 bool SdSpiCardEX::readBlock(uint32_t block, uint8_t* dst) {
-  if (m_curState != READ_STATE || block != m_curBlock) {
-    if (!syncBlocks()) {
-      return false;
-    }
-    if (!SdSpiCard::readStart(block)) {
-      return false;
-    }
-    m_curBlock = block;
-    m_curState = READ_STATE;
+  if (!readContinue(block)) {
+    return false;
   }
   if (!SdSpiCard::readData(dst)) {
     return false;
@@ -42,11 +35,32 @@ bool SdSpiCardEX::readBlock(uint32_t block, uint8_t* dst) {
 }
 //-----------------------------------------------------------------------------
 bool SdSpiCardEX::readBlocks(uint32_t block, uint8_t* dst, size_t nb) {
-  for (size_t i = 0; i < nb; i++) {
-    if (!readBlock(block + i, dst + i*512UL)) {
+  if (!readContinue(block)) {
+    return false;
+  }
+  for (size_t i = 0; i < nb; i++, dst += 512) {
+    if (!SdSpiCard::readData(dst)) {
       return false;
     }
+    m_curBlock++;
+  }
+  return true;
+}
+//-----------------------------------------------------------------------------
+bool SdSpiCardEX::readContinue(uint32_t block) {
+  if (m_curState == READ_STATE && block == m_curBlock) {
+    m_savedCommandCount++;
+    return true;
+  }
+  if (!syncBlocks()) {
+    return false;
+  }
+  if (!SdSpiCard::readStart(block)) {
+    return false;
   }
+  m_commandCount++;
+  m_curBlock = block;
+  m_curState = READ_STATE;
   return true;
 }
 //-----------------------------------------------------------------------------
@@ -66,15 +80,8 @@ bool SdSpiCardEX::syncBlocks() {
 }
 //-----------------------------------------------------------------------------
 bool SdSpiCardEX::writeBlock(uint32_t block, const uint8_t* src) {
-  if (m_curState != WRITE_STATE || m_curBlock != block) {
-    if (!syncBlocks()) {
-      return false;
-    }
-    if (!SdSpiCard::writeStart(block)) {
-      return false;
-    }
-    m_curBlock = block;
-    m_curState = WRITE_STATE;
+  if (!writeContinue(block, 1)) {
+    return false;
   }
   if (!SdSpiCard::writeData(src)) {
     return false;
@@ -85,10 +92,34 @@ bool SdSpiCardEX::writeBlock(uint32_t block, const uint8_t* src) {
 //-----------------------------------------------------------------------------
 bool SdSpiCardEX::writeBlocks(uint32_t block,
                                   const uint8_t* src, size_t nb) {
-  for (size_t i = 0; i < nb; i++) {
-    if (!writeBlock(block + i, src + i*512UL)) {
+  if (!writeContinue(block, nb)) {
+    return false;
+  }
+  for (size_t i = 0; i < nb; i++, src += 512) {
+    if (!SdSpiCard::writeData(src)) {
       return false;
     }
+    m_curBlock++;
+  }
+  return true;
+}
+//-----------------------------------------------------------------------------
+bool SdSpiCardEX::writeContinue(uint32_t block, size_t nb) {
+  if (m_curState == WRITE_STATE && block == m_curBlock) {
+    m_savedCommandCount++;
+    return true;
+  }
+  if (!syncBlocks()) {
+    return false;
+  }
+  // Pre-erase count helps the card with large writes.  The transaction
+  // stays open for writes past nb.
+  if (nb > 1 ? !SdSpiCard::writeStart(block, nb)
+             : !SdSpiCard::writeStart(block)) {
+    return false;
   }
+  m_commandCount++;
+  m_curBlock = block;
+  m_curState = WRITE_STATE;
   return true;
 }
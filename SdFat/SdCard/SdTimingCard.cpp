@@ -0,0 +1,53 @@
+/**
+ * Copyright (c) 20011-2017 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include "SdTimingCard.h"
+#if ENABLE_TIMING_CARD_CLASS
+//------------------------------------------------------------------------------
+const SdTimingModel SdTimingCard::DEFAULT_MODEL = {
+  100,    // commandMicros
+  180,    // readBlockMicros
+  180,    // writeBlockMicros
+  800,    // writeBusyMicros
+  8192,   // auBlocks, 4 MiB
+  20000   // auCrossMicros
+};
+//------------------------------------------------------------------------------
+void SdTimingCard::addWrite(uint32_t block, size_t nb) {
+  waitBusy();
+  m_commandCount++;
+  m_elapsedMicros += m_model.commandMicros + nb*m_model.writeBlockMicros
+                     + m_model.writeBusyMicros;
+  if (!m_model.auBlocks || !nb) {
+    return;
+  }
+  uint32_t au = block/m_model.auBlocks;
+  uint32_t lastAu = (block + nb - 1)/m_model.auBlocks;
+  // Charge for starting in a new AU and for each AU boundary crossed.
+  uint32_t n = lastAu - au + (au != m_lastWriteAu ? 1 : 0);
+  m_auCrossCount += n;
+  m_elapsedMicros += (uint64_t)n*m_model.auCrossMicros;
+  m_lastWriteAu = lastAu;
+}
+#endif  // ENABLE_TIMING_CARD_CLASS
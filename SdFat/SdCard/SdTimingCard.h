@@ -0,0 +1,223 @@
+/**
+ * Copyright (c) 20011-2017 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef SdTimingCard_h
+#define SdTimingCard_h
+/**
+ * \file
+ * \brief Block driver that models SD card timing.
+ */
+#include "../SysCall.h"
+#include "../BlockDriver.h"
+#if ENABLE_TIMING_CARD_CLASS || defined(DOXYGEN)
+//------------------------------------------------------------------------------
+/**
+ * \struct SdTimingModel
+ * \brief Latency model for SdTimingCard.  All times are in microseconds.
+ */
+struct SdTimingModel {
+  /** Overhead of each read or write command. */
+  uint32_t commandMicros;
+  /** Transfer time for one block read. */
+  uint32_t readBlockMicros;
+  /** Transfer time for one block write. */
+  uint32_t writeBlockMicros;
+  /** Program busy time at the end of each write command. */
+  uint32_t writeBusyMicros;
+  /** Allocation unit size in blocks, zero for no AU model. */
+  uint32_t auBlocks;
+  /** Penalty for a write that starts in or crosses into a new AU. */
+  uint32_t auCrossMicros;
+};
+//------------------------------------------------------------------------------
+/**
+ * \class SdTimingCard
+ * \brief Simulate SD card latency for another block driver.
+ *
+ * Each operation is passed to the wrapped driver and its cost under the
+ * SdTimingModel is added to a virtual clock.  Caching, batching and sync
+ * policies can then be compared by virtual time on a host with a fast
+ * driver such as SdImageCard.  Mount with FatFileSystem::begin().
+ */
+class SdTimingCard : public BaseBlockDriver {
+ public:
+  /** Default model, roughly a class 10 card on a 25 MHz SPI bus. */
+  static const SdTimingModel DEFAULT_MODEL;
+
+  SdTimingCard() : m_dev(0) {
+    m_model = DEFAULT_MODEL;
+    reset();
+  }
+  /** Initialize the simulator.
+   * \param[in] dev Driver that does the I/O.
+   * \param[in] model Latency model or zero for DEFAULT_MODEL.
+   */
+  void begin(BaseBlockDriver* dev, const SdTimingModel* model = 0) {
+    m_dev = dev;
+    m_model = model ? *model : DEFAULT_MODEL;
+    reset();
+  }
+  /** Advance the virtual clock for application work.  Work done while
+   * a started write is busy overlaps the busy time.
+   * \param[in] micros Microseconds to add.
+   */
+  void advance(uint32_t micros) {
+    m_elapsedMicros += micros;
+  }
+  /** \return Number of AU changes by write commands. */
+  uint32_t auCrossCount() const {
+    return m_auCrossCount;
+  }
+  /** \return Number of read and write commands. */
+  uint32_t commandCount() const {
+    return m_commandCount;
+  }
+  /** \return Virtual time in microseconds since begin() or reset(). */
+  uint64_t elapsedMicros() const {
+    return m_elapsedMicros;
+  }
+  /** \return The latency model. */
+  SdTimingModel* model() {
+    return &m_model;
+  }
+  /** Zero the virtual clock and counters. */
+  void reset() {
+    m_elapsedMicros = 0;
+    m_commandCount = 0;
+    m_auCrossCount = 0;
+    m_lastWriteAu = 0XFFFFFFFF;
+    m_busyUntil = 0;
+  }
+  /**
+   * Read a 512 byte block.
+   *
+   * \param[in] block Logical block to be read.
+   * \param[out] dst Pointer to the location that will receive the data.
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool readBlock(uint32_t block, uint8_t* dst) {
+    addRead(1);
+    return m_dev->readBlock(block, dst);
+  }
+  /** End multi-block transfer and go to idle state.
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool syncBlocks() {
+    return m_dev->syncBlocks();
+  }
+  /**
+   * Writes a 512 byte block.
+   *
+   * \param[in] block Logical block to be written.
+   * \param[in] src Pointer to the location of the data to be written.
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool writeBlock(uint32_t block, const uint8_t* src) {
+    addWrite(block, 1);
+    return m_dev->writeBlock(block, src);
+  }
+#if USE_MULTI_BLOCK_IO
+  /**
+   * Read multiple 512 byte blocks.
+   *
+   * \param[in] block Logical block to be read.
+   * \param[in] nb Number of blocks to be read.
+   * \param[out] dst Pointer to the location that will receive the data.
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool readBlocks(uint32_t block, uint8_t* dst, size_t nb) {
+    addRead(nb);
+    return m_dev->readBlocks(block, dst, nb);
+  }
+  /**
+   * Write multiple 512 byte blocks.
+   *
+   * \param[in] block Logical block to be written.
+   * \param[in] nb Number of blocks to be written.
+   * \param[in] src Pointer to the location of the data to be written.
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool writeBlocks(uint32_t block, const uint8_t* src, size_t nb) {
+    addWrite(block, nb);
+    return m_dev->writeBlocks(block, src, nb);
+  }
+#endif  // USE_MULTI_BLOCK_IO
+#if USE_ASYNC_BLOCK_IO
+  /**
+   * Start a block write.  The program busy time is not charged to the
+   * virtual clock.  It runs until poll(), advance() or the next command
+   * catches up with it.
+   *
+   * \param[in] block Logical block to be written.
+   * \param[in] src Pointer to the location of the data to be written.
+   * \return The value true is returned for success and
+   * the value false is returned for failure.
+   */
+  bool writeBlockStart(uint32_t block, const uint8_t* src) {
+    addWrite(block, 1);
+    m_elapsedMicros -= m_model.writeBusyMicros;
+    m_busyUntil = m_elapsedMicros + m_model.writeBusyMicros;
+    return m_dev->writeBlockStart(block, src);
+  }
+  /** Check for busy, each call costs commandMicros of virtual time.
+   * \return one if the card is idle, zero if it is busy,
+   * or minus one for an error.
+   */
+  int8_t poll() {
+    if (m_elapsedMicros < m_busyUntil) {
+      m_elapsedMicros += m_model.commandMicros;
+      return 0;
+    }
+    return m_dev->poll();
+  }
+#endif  // USE_ASYNC_BLOCK_IO
+
+ private:
+  void addRead(size_t nb) {
+    waitBusy();
+    m_commandCount++;
+    m_elapsedMicros += m_model.commandMicros + nb*m_model.readBlockMicros;
+  }
+  void addWrite(uint32_t block, size_t nb);
+  void waitBusy() {
+    if (m_elapsedMicros < m_busyUntil) {
+      m_elapsedMicros = m_busyUntil;
+    }
+  }
+
+  BaseBlockDriver* m_dev;
+  SdTimingModel m_model;
+  uint64_t m_elapsedMicros;
+  uint32_t m_commandCount;
+  uint32_t m_auCrossCount;
+  uint32_t m_lastWriteAu;
+  uint64_t m_busyUntil;
+};
+#endif  // ENABLE_TIMING_CARD_CLASS || defined(DOXYGEN)
+#endif  // SdTimingCard_h
@@ -32,6 +32,8 @@
 #include "BlockDriver.h"
 #include "FatLib/FatLib.h"
 #include "SdCard/SdioCard.h"
+#include "SdCard/SdImageCard.h"
+#include "SdCard/SdTimingCard.h"
 //------------------------------------------------------------------------------
 /** SdFat version */
 #define SD_FAT_VERSION "1.0.5"
@@ -488,6 +490,62 @@ class SdFatSoftSpiEX : public SdFileSystem<SdSpiCardEX>  {
 };
 #endif  // #if ENABLE_SOFTWARE_SPI_CLASS || defined(DOXYGEN)
 #endif  // ENABLE_EXTENDED_TRANSFER_CLASS || defined(DOXYGEN)
+#if ENABLE_IMAGE_CARD_CLASS || defined(DOXYGEN)
+//=============================================================================
+/**
+ * \class SdFatImage
+ * \brief SdFat class using a FAT volume image file.
+ */
+class SdFatImage : public SdFileSystem<SdImageCard> {
+ public:
+  /** Open an image file and initialize the file system.
+   * \param[in] path Image file name.
+   * \return true for success else false.
+   */
+  bool begin(const char* path) {
+    return m_card.begin(path) && SdFileSystem::begin();
+  }
+  /** Close the image file. */
+  void end() {
+    m_card.end();
+  }
+};
+#if ENABLE_TIMING_CARD_CLASS || defined(DOXYGEN)
+//=============================================================================
+/**
+ * \class SdFatTiming
+ * \brief SdFatImage with an SdTimingCard between the volume and the image.
+ *
+ * The image does the I/O and the timing card adds up the virtual time a
+ * real card would take for it.
+ */
+class SdFatTiming : public SdFileSystem<SdImageCard> {
+ public:
+  /** Open an image file and initialize the file system.
+   * \param[in] path Image file name.
+   * \param[in] model Latency model or zero for the default model.
+   * \return true for success else false.
+   */
+  bool begin(const char* path, const SdTimingModel* model = 0) {
+    if (!m_card.begin(path)) {
+      return false;
+    }
+    m_timing.begin(&m_card, model);
+    return FatFileSystem::begin(&m_timing);
+  }
+  /** Close the image file. */
+  void end() {
+    m_card.end();
+  }
+  /** \return Pointer to the timing card. */
+  SdTimingCard* timing() {
+    return &m_timing;
+  }
+ private:
+  SdTimingCard m_timing;
+};
+#endif  // ENABLE_TIMING_CARD_CLASS || defined(DOXYGEN)
+#endif  // ENABLE_IMAGE_CARD_CLASS || defined(DOXYGEN)
 //=============================================================================
 /**
  * \class Sd2Card
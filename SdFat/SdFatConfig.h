@@ -62,7 +62,9 @@
  * These classes used extended multi-block SD I/O for better performance.
  * the SPI bus may not be shared with other devices in this mode.
  */
+#ifndef ENABLE_EXTENDED_TRANSFER_CLASS
 #define ENABLE_EXTENDED_TRANSFER_CLASS 0
+#endif  // ENABLE_EXTENDED_TRANSFER_CLASS
 //-----------------------------------------------------------------------------
 /**
  * If the symbol USE_STANDARD_SPI_LIBRARY is nonzero, the classes SdFat and
@@ -71,6 +73,20 @@
  */
 #define USE_STANDARD_SPI_LIBRARY 0
 //-----------------------------------------------------------------------------
+/**
+ * If the symbol SD_SPI_BULK_TRANSFER is nonzero, SdSpiLibDriver moves
+ * multi-byte data with one buffer SPI.transfer() call, DMA on Particle,
+ * instead of calling SPI.transfer() for each byte.  Set it to zero to use
+ * the byte at a time loops.
+ */
+#ifndef SD_SPI_BULK_TRANSFER
+#if defined(PLATFORM_ID)
+#define SD_SPI_BULK_TRANSFER 1
+#else  // defined(PLATFORM_ID)
+#define SD_SPI_BULK_TRANSFER 0
+#endif  // defined(PLATFORM_ID)
+#endif  // SD_SPI_BULK_TRANSFER
+//-----------------------------------------------------------------------------
 /**
  * If the symbol ENABLE_SOFTWARE_SPI_CLASS is nonzero, the class SdFatSoftSpi
  * will be defined. If ENABLE_EXTENDED_TRANSFER_CLASS is also nonzero,
@@ -78,6 +94,25 @@
  */
 #define ENABLE_SOFTWARE_SPI_CLASS 0
 //------------------------------------------------------------------------------
+/**
+ * If the symbol ENABLE_IMAGE_CARD_CLASS is nonzero, the class SdFatImage
+ * will be defined.  SdFatImage uses a FAT volume image in a host file in
+ * place of an SD card.  It requires stdio so is only for host builds.
+ */
+#ifndef ENABLE_IMAGE_CARD_CLASS
+#define ENABLE_IMAGE_CARD_CLASS 0
+#endif  // ENABLE_IMAGE_CARD_CLASS
+//------------------------------------------------------------------------------
+/**
+ * If the symbol ENABLE_TIMING_CARD_CLASS is nonzero, the class SdTimingCard
+ * will be defined.  SdTimingCard wraps another block driver and keeps a
+ * virtual clock from a model of SD command, transfer, busy and allocation
+ * unit costs.
+ */
+#ifndef ENABLE_TIMING_CARD_CLASS
+#define ENABLE_TIMING_CARD_CLASS 0
+#endif  // ENABLE_TIMING_CARD_CLASS
+//------------------------------------------------------------------------------
 /**
  * If CHECK_FLASH_PROGRAMMING is zero, overlap of single sector flash
  * programming and other operations will be allowed for faster write
@@ -86,14 +121,31 @@
  * Some cards will not sleep in low power mode unless CHECK_FLASH_PROGRAMMING
  * is non-zero.
  */
+#ifndef CHECK_FLASH_PROGRAMMING
 #define CHECK_FLASH_PROGRAMMING 1
+#endif  // CHECK_FLASH_PROGRAMMING
 //------------------------------------------------------------------------------
 /**
  * Set MAINTAIN_FREE_CLUSTER_COUNT nonzero to keep the count of free clusters
  * updated.  This will increase the speed of the freeClusterCount() call
  * after the first call.  Extra flash will be required.
  */
-#define MAINTAIN_FREE_CLUSTER_COUNT 0
+#define MAINTAIN_FREE_CLUSTER_COUNT 1
+//------------------------------------------------------------------------------
+/**
+ * Set USE_FSINFO_FREE_COUNT nonzero to seed the free cluster count of FAT32
+ * volumes from the FSINFO sector at mount and write the count back to FSINFO
+ * when the volume is synced.  Requires MAINTAIN_FREE_CLUSTER_COUNT nonzero.
+ *
+ * An FSINFO sector that fails validation causes the count to be found by
+ * a full scan of the FAT on the first freeClusterCount() call.  The first
+ * FAT change after a mount or sync writes an unknown count to FSINFO, and
+ * the real count is only written back once the FAT has been synced, so a
+ * reset mid-write never leaves a stale count behind.
+ */
+#ifndef USE_FSINFO_FREE_COUNT
+#define USE_FSINFO_FREE_COUNT 1
+#endif  // USE_FSINFO_FREE_COUNT
 //------------------------------------------------------------------------------
 /**
  * To enable SD card CRC checking set USE_SD_CRC nonzero.
@@ -103,8 +155,27 @@
  *
  * Set USE_SD_CRC to 2 to used a larger table driven CRC-CCITT function.  This
  * function is faster for AVR but may be slower for ARM and other processors.
+ *
+ * Set USE_SD_CRC to 3 to use four tables and process four bytes per step.
+ * This is the fastest choice for 32-bit processors and uses 2 KB of flash.
+ * The tables are generated at compile time.  AVR uses the USE_SD_CRC 2
+ * function.
+ */
+#ifndef USE_SD_CRC
+#define USE_SD_CRC 3
+#endif  // USE_SD_CRC
+/**
+ * If SD_CRC_CHUNK_SIZE is nonzero and SdSpiLibDriver moves data with bulk
+ * DMA transfers, the CRC is computed while the DMA runs.  A block is read
+ * SD_CRC_CHUNK_SIZE bytes at a time, and the CRC of each chunk is updated
+ * while the next chunk is received.  A block to be written is sent with one
+ * DMA transfer and its CRC is computed during the transfer.
+ *
+ * Set SD_CRC_CHUNK_SIZE to zero to transfer each block and then CRC it.
  */
-#define USE_SD_CRC 1  //This adds 192 bytes to program size
+#ifndef SD_CRC_CHUNK_SIZE
+#define SD_CRC_CHUNK_SIZE 0
+#endif  // SD_CRC_CHUNK_SIZE
 //------------------------------------------------------------------------------
 /**
  * Handle Watchdog Timer for WiFi modules.
@@ -119,6 +190,18 @@
 #define WDT_YIELD_TIME_MICROS 0
 #endif
 //------------------------------------------------------------------------------
+/**
+ * Set USE_SD_YIELD_CALLBACK nonzero to allow a user function to be called
+ * from SdSpiCard wait loops and to count wait time by reason.
+ *
+ * The function set by SdSpiCard::yieldCallback() is called at most once
+ * every SD_YIELD_CALLBACK_MICROS microseconds with the milliseconds spent
+ * in the current wait and the reason for the wait.  The card is selected
+ * during the call so the function must not access the card.
+ */
+#define USE_SD_YIELD_CALLBACK 1
+#define SD_YIELD_CALLBACK_MICROS 20000
+//------------------------------------------------------------------------------
 /**
  * Set FAT12_SUPPORT nonzero to enable use if FAT12 volumes.
  * FAT12 has not been well tested and requires additional flash.
@@ -162,6 +245,136 @@
 // #define USE_SEPARATE_FAT_CACHE 0
 // #endif  // __arm__
 //------------------------------------------------------------------------------
+/**
+ * FAT_CACHE_BLOCK_COUNT is the number of 512 byte blocks in each FatVolume
+ * block cache.  Blocks are replaced least recently used first and dirty
+ * blocks are written in LBN order on sync.  A value of one gives the
+ * original single block cache.
+ */
+#ifndef FAT_CACHE_BLOCK_COUNT
+#define FAT_CACHE_BLOCK_COUNT 1
+#endif  // FAT_CACHE_BLOCK_COUNT
+//------------------------------------------------------------------------------
+/**
+ * Set USE_FAT_EXTENT_CACHE nonzero to keep up to FAT_EXTENT_CACHE_SIZE
+ * runs of contiguous clusters in each open file.  seekSet() then finds the
+ * cluster for a position without following the FAT chain from the start
+ * of the file.  Each entry uses 12 bytes of RAM in every FatFile.
+ */
+#ifndef USE_FAT_EXTENT_CACHE
+#define USE_FAT_EXTENT_CACHE 0
+#endif  // USE_FAT_EXTENT_CACHE
+#ifndef FAT_EXTENT_CACHE_SIZE
+#define FAT_EXTENT_CACHE_SIZE 4
+#endif  // FAT_EXTENT_CACHE_SIZE
+//------------------------------------------------------------------------------
+/**
+ * Set FAT_NAME_CACHE_SIZE nonzero to remember where recently opened files
+ * are in their directory.  Each entry holds the directory cluster, a hash
+ * of the case folded name and the entry index, 12 bytes per entry.
+ *
+ * open() with long file names checks the cached entry, its SFN and any LFN
+ * entries, before scanning the directory, so reopening a file usually reads
+ * one directory block.  Entries are added on open and create and dropped
+ * when the file is removed or renamed.
+ */
+#ifndef FAT_NAME_CACHE_SIZE
+#define FAT_NAME_CACHE_SIZE 0
+#endif  // FAT_NAME_CACHE_SIZE
+//------------------------------------------------------------------------------
+/**
+ * Set FAT_DIR_ENTRY_NAME_DIM nonzero to enable FatFile::readDirEntries().
+ * It walks a directory and fills an array of FatDirEntry_t records with the
+ * name, attributes, size, first cluster, dates and index of each entry
+ * without opening the files.  Names longer than FAT_DIR_ENTRY_NAME_DIM - 1
+ * characters are truncated.
+ */
+#ifndef FAT_DIR_ENTRY_NAME_DIM
+#define FAT_DIR_ENTRY_NAME_DIM 32
+#endif  // FAT_DIR_ENTRY_NAME_DIM
+//------------------------------------------------------------------------------
+/**
+ * Set FAT_FREE_BATCH_SIZE nonzero to free cluster chains in batches of that
+ * many clusters.  A batch is sorted so each FAT block is fetched and
+ * written once, and the free count and allocation start are updated once.
+ * Each entry uses four bytes of RAM in the volume.
+ *
+ * rmRfStar() holds the batch across the whole tree and syncs the cache
+ * once at the end instead of after every file.
+ */
+#ifndef FAT_FREE_BATCH_SIZE
+#define FAT_FREE_BATCH_SIZE 0
+#endif  // FAT_FREE_BATCH_SIZE
+//------------------------------------------------------------------------------
+/**
+ * Set FAT_DIR_SYNC_LAG nonzero to let sync() skip the directory entry
+ * update of a growing file until the file is that many bytes larger than
+ * the size in the entry.  Data and FAT blocks are still written by every
+ * sync() so only the size and modify time in the directory entry lag.
+ *
+ * close(), truncate(), rename() and timestamp() always write the entry.
+ * The bytes past the end of data in the last block are written as zero so
+ * FatFile::recoverSize() can find the end of a text file after a reset.
+ */
+#ifndef FAT_DIR_SYNC_LAG
+#define FAT_DIR_SYNC_LAG 0
+#endif  // FAT_DIR_SYNC_LAG
+//------------------------------------------------------------------------------
+/**
+ * STDIO_STREAM_BUF_SIZE is the size of the StdioStream buffer.  If it is a
+ * multiple of 512, flushes after the first one end on a block boundary so
+ * whole blocks are written to the device without the block cache.
+ */
+#ifndef STDIO_STREAM_BUF_SIZE
+#define STDIO_STREAM_BUF_SIZE 64
+#endif  // STDIO_STREAM_BUF_SIZE
+//------------------------------------------------------------------------------
+/**
+ * FAT_MIRROR_MODE selects when the second FAT is written.
+ *
+ * 0 - Write the second FAT copy of a block with each first FAT write.
+ *
+ * 1 - Keep a sorted list of up to FAT_MIRROR_PENDING_BLOCKS changed FAT
+ *     blocks and copy them to the second FAT in block order at the next
+ *     cache sync, or when the list is full.
+ *
+ * 2 - Only write the first FAT.  The second FAT goes stale, so use this only
+ *     for cards that are never repaired by another system.
+ */
+#ifndef FAT_MIRROR_MODE
+#define FAT_MIRROR_MODE 0
+#endif  // FAT_MIRROR_MODE
+#ifndef FAT_MIRROR_PENDING_BLOCKS
+#define FAT_MIRROR_PENDING_BLOCKS 8
+#endif  // FAT_MIRROR_PENDING_BLOCKS
+//------------------------------------------------------------------------------
+/**
+ * Set FAT_FREE_MAP_BYTES nonzero to keep an in-RAM summary of free space.
+ * Each bit covers a power of two group of clusters sized so the map spans
+ * the whole FAT.  A bit is cleared when allocateCluster() scans its entire
+ * group without finding a free cluster and set again when a cluster in the
+ * group is freed.  allocateCluster() then jumps over full groups instead of
+ * reading every FAT entry in them.  The map is rebuilt lazily after mount.
+ */
+#ifndef FAT_FREE_MAP_BYTES
+#define FAT_FREE_MAP_BYTES 0
+#endif  // FAT_FREE_MAP_BYTES
+//------------------------------------------------------------------------------
+/**
+ * Set USE_ASYNC_BLOCK_IO nonzero to return from single block writes when
+ * the card has accepted the data instead of waiting for flash programming.
+ *
+ * Block drivers get writeBlockStart(), readBlocksStart() and poll().  The
+ * volume writes single blocks with writeBlockStart() and the next command
+ * waits for the card.  Call poll() until it returns nonzero to hand the
+ * CPU to other work while the last write programs.  With
+ * CHECK_FLASH_PROGRAMMING the programming status is checked by poll() or
+ * the next command, which fails if the earlier write did not program.
+ */
+#ifndef USE_ASYNC_BLOCK_IO
+#define USE_ASYNC_BLOCK_IO 0
+#endif  // USE_ASYNC_BLOCK_IO
+//------------------------------------------------------------------------------
 /**
  * Set USE_MULTI_BLOCK_IO nonzero to use multi-block SD read/write.
  *
@@ -173,6 +386,39 @@
 #define USE_MULTI_BLOCK_IO 1
 // #endif  // RAMEND
 //-----------------------------------------------------------------------------
+/**
+ * FAT_READ_AHEAD_BLOCKS is the size in blocks of a read-ahead buffer in
+ * each FatVolume.  When a partial block read of a file follows the block
+ * read before it, up to this many blocks of the current cluster are read
+ * with one multi-block read and later reads are copied from the buffer.
+ * Zero disables read-ahead.  Requires USE_MULTI_BLOCK_IO.
+ */
+#ifndef FAT_READ_AHEAD_BLOCKS
+#define FAT_READ_AHEAD_BLOCKS 0
+#endif  // FAT_READ_AHEAD_BLOCKS
+//-----------------------------------------------------------------------------
+/**
+ * Set USE_FAT_IO_COUNTERS nonzero to count the blocks each FatVolume reads
+ * and writes.  See FatVolume::blockReadCount() and blockWriteCount().
+ */
+#ifndef USE_FAT_IO_COUNTERS
+#define USE_FAT_IO_COUNTERS 0
+#endif  // USE_FAT_IO_COUNTERS
+//-----------------------------------------------------------------------------
+/**
+ * Set USE_FAT_IO_TRACE nonzero to keep a trace of the last FAT_IO_TRACE_SIZE
+ * block reads, block writes, FAT mirror writes, cache hits, cache misses
+ * and syncs of each FatVolume.  See FatVolume::trace() and dumpTrace().
+ *
+ * Each trace record uses 16 bytes of RAM.
+ */
+#ifndef USE_FAT_IO_TRACE
+#define USE_FAT_IO_TRACE 0
+#endif  // USE_FAT_IO_TRACE
+#ifndef FAT_IO_TRACE_SIZE
+#define FAT_IO_TRACE_SIZE 64
+#endif  // FAT_IO_TRACE_SIZE
+//-----------------------------------------------------------------------------
 /** Enable SDIO driver if available. */
 #if defined(__MK64FX512__) || defined(__MK66FX1M0__)
 #define ENABLE_SDIO_CLASS 1
@@ -60,11 +60,15 @@ class SdSpiLibDriver : public SdSpiBaseDriver {
   class SdSpiLibDriver {
     #endif  // ENABLE_SOFTWARE_SPI_CLASS
   public:
-    /** Activate SPI hardware. */
+    /** Activate SPI hardware.
+    *
+    * On Particle beginTransaction() also takes the SPI bus lock, so the
+    * card owns the bus until deactivate() while other threads keep running.
+    */
     void activate() {
       SDCARD_SPI.beginTransaction(m_spiSettings);
     }
-    /** Deactivate SPI hardware. */
+    /** Deactivate SPI hardware and release the bus lock. */
     void deactivate() {
       SDCARD_SPI.endTransaction();
     }
@@ -94,12 +98,7 @@ class SdSpiLibDriver : public SdSpiBaseDriver {
       Serial.println("SPI receive a byte");
       #endif
 
-      uint8_t returnVal;
-      SINGLE_THREADED_BLOCK(){
-         returnVal = SDCARD_SPI.transfer( 0XFF);
-      }
-
-      return returnVal;
+      return SDCARD_SPI.transfer(0XFF);
     }
     /** Receive multiple bytes.
     *
@@ -118,11 +117,15 @@ class SdSpiLibDriver : public SdSpiBaseDriver {
       if(SD_FAT_DEBUG_ENABLED)
       Serial.printlnf("SPI receive multiple bytes (%u)", n);
       #endif
-      SINGLE_THREADED_BLOCK(){
-         for (size_t i = 0; i < n; i++) {
-            buf[i] = SDCARD_SPI.transfer(0XFF);
-         }
+#if SD_SPI_BULK_TRANSFER
+      // A null tx buffer sends 0XFF bytes and a null callback waits
+      // for the DMA transfer to complete.
+      SDCARD_SPI.transfer(NULL, buf, n, NULL);
+#else  // SD_SPI_BULK_TRANSFER
+      for (size_t i = 0; i < n; i++) {
+        buf[i] = SDCARD_SPI.transfer(0XFF);
       }
+#endif  // SD_SPI_BULK_TRANSFER
       return 0;
     }
     /** Send a byte.
@@ -139,11 +142,34 @@ class SdSpiLibDriver : public SdSpiBaseDriver {
       if(SD_FAT_DEBUG_ENABLED)
       Serial.println("SPI send byte");
       #endif
-      SINGLE_THREADED_BLOCK(){
-         SDCARD_SPI.transfer(data);
-      }
-
+      SDCARD_SPI.transfer(data);
     }
+#if SD_SPI_BULK_TRANSFER
+    /** Start a DMA receive, 0XFF is sent.  Call transferWait() before
+     * buf is used or another transfer is made.
+     *
+     * \param[out] buf Buffer to receive the data.
+     * \param[in] n Number of bytes to receive.
+     */
+    void receiveStart(uint8_t* buf, size_t n) {
+      dmaDone() = false;
+      SDCARD_SPI.transfer(NULL, buf, n, dmaCallback);
+    }
+    /** Start a DMA send.  Call transferWait() before buf is changed or
+     * another transfer is made.
+     *
+     * \param[in] buf Buffer for data to be sent.
+     * \param[in] n Number of bytes to send.
+     */
+    void sendStart(const uint8_t* buf, size_t n) {
+      dmaDone() = false;
+      SDCARD_SPI.transfer(const_cast<uint8_t*>(buf), NULL, n, dmaCallback);
+    }
+    /** Wait for receiveStart() or sendStart() to finish. */
+    void transferWait() {
+      while (!dmaDone()) {}
+    }
+#endif  // SD_SPI_BULK_TRANSFER
     /** Send multiple bytes.
     *
     * \param[in] buf Buffer for data to be sent.
@@ -159,11 +185,13 @@ class SdSpiLibDriver : public SdSpiBaseDriver {
       if(SD_FAT_DEBUG_ENABLED)
       Serial.printlnf("SPI send multiple bytes (%u)", __LINE__);
       #endif
-      SINGLE_THREADED_BLOCK(){
-         for (size_t i = 0; i < n; i++) {
-            SDCARD_SPI.transfer(buf[i]);
-         }
+#if SD_SPI_BULK_TRANSFER
+      SDCARD_SPI.transfer(const_cast<uint8_t*>(buf), NULL, n, NULL);
+#else  // SD_SPI_BULK_TRANSFER
+      for (size_t i = 0; i < n; i++) {
+        SDCARD_SPI.transfer(buf[i]);
       }
+#endif  // SD_SPI_BULK_TRANSFER
     }
     /** Set CS low. */
     void select() {
@@ -182,6 +210,16 @@ class SdSpiLibDriver : public SdSpiBaseDriver {
     }
 
   private:
+#if SD_SPI_BULK_TRANSFER
+    static void dmaCallback() {
+      dmaDone() = true;
+    }
+    // Set by the DMA complete callback, shared by every driver instance.
+    static volatile bool& dmaDone() {
+      static volatile bool done = true;
+      return done;
+    }
+#endif  // SD_SPI_BULK_TRANSFER
     SPISettings m_spiSettings;
     uint8_t m_csPin;
   };
@@ -362,6 +400,13 @@ class SdSpiLibDriver : public SdSpiBaseDriver {
     // Don't need virtual driver.
     typedef SdFatSpiDriver SdSpiDriver;
     #endif  // ENABLE_SOFTWARE_SPI_CLASS
+    /** SdSpiDriver has receiveStart(), sendStart() and transferWait(). */
+    #if SD_SPI_BULK_TRANSFER && !ENABLE_SOFTWARE_SPI_CLASS &&\
+      (USE_STANDARD_SPI_LIBRARY || !SD_HAS_CUSTOM_SPI)
+    #define SD_SPI_ASYNC_TRANSFER 1
+    #else  // SD_SPI_BULK_TRANSFER ...
+    #define SD_SPI_ASYNC_TRANSFER 0
+    #endif  // SD_SPI_BULK_TRANSFER ...
     //=============================================================================
     // Use of in-line for AVR to save flash.
     #ifdef __AVR__
@@ -0,0 +1,515 @@
+/* Host benchmark for JazaSD and FatLib on a FAT32 card image.
+ *
+ * Usage: bench [MB] [blocksPerCluster]
+ *
+ * Makes a fresh sparse FAT32 image at JAZASD_HOST_IMAGE_PATH (default
+ * 1024 MB with 8 blocks per cluster), mounts it with jazaSD.begin() and
+ * runs each scenario in turn.  For each scenario it prints the blocks and
+ * commands read and written and the wall time.  The block cache is flushed
+ * and emptied at the end of every scenario, so writes left in the cache are
+ * counted and the next scenario starts cold.
+ *
+ * With JAZASD_HOST_IMAGE 1 (bench) the card is SdImageCard and the counts
+ * are its own.  With JAZASD_HOST_IMAGE 0 (bench-spi) JazaSD uses SdFat and
+ * SdSpiCard talking to HostSdCard over the SPI shim, and the counts come
+ * from the card, along with every command sent and every SPI transfer.
+ * bench-spi built with USE_ASYNC_BLOCK_IO=1 first checks that syncs and
+ * commands wait for writeBlockStart() and readBlocksStart().
+ * With JAZASD_ENABLE_ASYNC_WRITES 1 JazaSD's worker thread writes a second
+ * batch of rows queued by fileEntry(), and the bench checks each one.
+ * bench-ex is bench-spi with JazaSD on SdFatEX, and adds the card commands
+ * SdSpiCardEX sent and the ones it saved by continuing a multi-block
+ * transfer.
+ *
+ * bench built with SD_TIMING=1 mounts the image through SdTimingCard and
+ * adds the virtual time a real card would take for each scenario, with the
+ * commands and allocation unit crossings the model charged for.
+ *
+ * Build with different SdFatConfig.h options to compare them, e.g.
+ *   make -B run DEFS="-DFAT_CACHE_BLOCK_COUNT=1"
+ */
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "JazaSD.h"
+#include "PCB/jazaPinout.h"
+
+// time each scenario on the SdTimingCard model as well as the wall clock
+#define SD_TIMING (JAZASD_HOST_IMAGE && ENABLE_TIMING_CARD_CLASS)
+#if SD_TIMING
+extern SdFatTiming sd;
+#elif JAZASD_HOST_IMAGE
+extern SdFatImage sd;
+#elif JAZASD_USE_SD_EX
+extern SdFatEX sd;
+#else  // JAZASD_HOST_IMAGE
+extern SdFat sd;
+#endif  // JAZASD_HOST_IMAGE
+extern JazaSD jazaSD;
+
+#define CHECK(x) \
+  do { \
+    if (!(x)) { \
+      printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #x); \
+      exit(1); \
+    } \
+  } while (0)
+//------------------------------------------------------------------------------
+// Deterministic random numbers so every build runs the same workload.
+static uint32_t rngState = 1;
+static uint32_t rng(uint32_t n) {
+  rngState = rngState*1103515245 + 12345;
+  return (rngState >> 8) % n;
+}
+//------------------------------------------------------------------------------
+// Write an empty FAT32 volume, no partition table, FSINFO at block 1.
+static void makeImage(const char* path, uint32_t mb, uint32_t spc) {
+  const uint32_t rsvd = 32;
+  const uint32_t nFats = 2;
+  uint32_t total = mb*2048;
+  uint32_t fatSize = 1;
+  uint32_t clusters;
+  for (;;) {
+    clusters = (total - rsvd - nFats*fatSize)/spc;
+    uint32_t need = ((clusters + 2)*4 + 511)/512;
+    if (need <= fatSize) {
+      break;
+    }
+    fatSize = need;
+  }
+  if (clusters < 65525) {
+    printf("%u MB with %u blocks per cluster is not FAT32\n", mb, spc);
+    exit(1);
+  }
+  uint8_t* img = static_cast<uint8_t*>(calloc(rsvd + nFats*fatSize, 512));
+  CHECK(img);
+  uint8_t* bs = img;
+  memcpy(bs, "\xEB\x58\x90MSWIN4.1", 11);
+  bs[11] = 0;               // 512 bytes per sector
+  bs[12] = 2;
+  bs[13] = spc;
+  bs[14] = rsvd;
+  bs[16] = nFats;
+  bs[21] = 0XF8;            // media
+  bs[24] = 63;              // sectors per track
+  bs[26] = 255;             // heads
+  memcpy(bs + 32, &total, 4);
+  memcpy(bs + 36, &fatSize, 4);
+  bs[44] = 2;               // root cluster
+  bs[48] = 1;               // FSINFO sector
+  bs[50] = 6;               // backup boot sector
+  bs[64] = 0X80;
+  bs[66] = 0X29;
+  memcpy(bs + 71, "NO NAME    FAT32   ", 19);
+  bs[510] = 0X55;
+  bs[511] = 0XAA;
+  memcpy(img + 6*512, bs, 512);
+  uint8_t* fsi = img + 512;
+  uint32_t v = 0X41615252;
+  memcpy(fsi, &v, 4);
+  v = 0X61417272;
+  memcpy(fsi + 484, &v, 4);
+  v = clusters - 1;         // root directory uses one cluster
+  memcpy(fsi + 488, &v, 4);
+  v = 3;
+  memcpy(fsi + 492, &v, 4);
+  v = 0XAA550000;
+  memcpy(fsi + 508, &v, 4);
+  for (uint32_t f = 0; f < nFats; f++) {
+    uint32_t fat[3] = {0X0FFFFFF8, 0X0FFFFFFF, 0X0FFFFFFF};
+    memcpy(img + (rsvd + f*fatSize)*512, fat, sizeof(fat));
+  }
+  FILE* file = fopen(path, "wb");
+  CHECK(file);
+  CHECK(fwrite(img, 512, rsvd + nFats*fatSize, file) == rsvd + nFats*fatSize);
+  CHECK(ftruncate(fileno(file), (off_t)total*512) == 0);
+  fclose(file);
+  free(img);
+}
+//------------------------------------------------------------------------------
+#if !JAZASD_HOST_IMAGE && JAZASD_USE_SD_EX
+// SdSpiCardEX counts from begin(), remount() zeroes the start counts
+static uint32_t meterExCommands;
+static uint32_t meterExSaved;
+#endif  // !JAZASD_HOST_IMAGE && JAZASD_USE_SD_EX
+// Mount the card again, as a reset would.
+static bool remount() {
+#if JAZASD_HOST_IMAGE
+  return sd.begin(JAZASD_HOST_IMAGE_PATH);
+#elif JAZASD_USE_SD_EX
+  meterExCommands = meterExSaved = 0;
+  return sd.begin(SD_CHIPSELECT);
+#else  // JAZASD_HOST_IMAGE
+  return sd.begin(SD_CHIPSELECT);
+#endif  // JAZASD_HOST_IMAGE
+}
+//------------------------------------------------------------------------------
+// Block and time cost of one scenario.
+static const char* meterName;
+static uint64_t meterStart;
+
+static uint64_t nowMicros() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+static void meterBegin(const char* name) {
+  meterName = name;
+#if JAZASD_HOST_IMAGE
+  sd.card()->resetCounters();
+#else  // JAZASD_HOST_IMAGE
+#if JAZASD_USE_SD_EX
+  // card() ends an open transfer, before the counts start
+  meterExCommands = sd.card()->commandCount();
+  meterExSaved = sd.card()->savedCommandCount();
+#endif  // JAZASD_USE_SD_EX
+  hostSdCard.resetCounters();
+#endif  // JAZASD_HOST_IMAGE
+#if SD_TIMING
+  sd.timing()->reset();
+#endif  // SD_TIMING
+  meterStart = nowMicros();
+}
+static void meterEnd(uint32_t ops) {
+  CHECK(sd.vol()->cacheClear());
+  uint64_t us = nowMicros() - meterStart;
+#if JAZASD_HOST_IMAGE
+  SdImageCard* card = sd.card();
+  printf("%-34s %7u %9u %8u %9u %8u %10llu", meterName, ops,
+         card->readBlockCount(), card->readCommandCount(),
+         card->writeBlockCount(), card->writeCommandCount(),
+         (unsigned long long)us);
+#if SD_TIMING
+  SdTimingCard* timing = sd.timing();
+  printf(" %12llu %8u %8u", (unsigned long long)timing->elapsedMicros(),
+         timing->commandCount(), timing->auCrossCount());
+#endif  // SD_TIMING
+  printf("\n");
+#else  // JAZASD_HOST_IMAGE
+#if JAZASD_USE_SD_EX
+  // the transfer left open is ended and counted with the scenario
+  SdSpiCardEX* card = sd.card();
+#endif  // JAZASD_USE_SD_EX
+  const HostSdCounters& c = hostSdCard.counters();
+  printf("%-34s %7u %9u %8u %9u %8u %8u %9u %10llu", meterName, ops,
+         c.readBlocks, c.readCmds, c.writeBlocks, c.writeCmds, c.commands,
+         c.transfers, (unsigned long long)us);
+#if JAZASD_USE_SD_EX
+  printf(" %8u %8u", card->commandCount() - meterExCommands,
+         card->savedCommandCount() - meterExSaved);
+#endif  // JAZASD_USE_SD_EX
+  printf("\n");
+  CHECK(c.crcErrors == 0);
+#endif  // JAZASD_HOST_IMAGE
+}
+//------------------------------------------------------------------------------
+static int makeRow(char* row, size_t size, uint32_t n) {
+  return snprintf(row, size, "%lu,%lu,key%lu,PUBLISHED,some payload text",
+                  (unsigned long)(the_time + n), (unsigned long)rng(100000),
+                  (unsigned long)n);
+}
+//------------------------------------------------------------------------------
+#if JAZASD_ENABLE_ASYNC_WRITES
+// Called on the worker thread, read once flush() has returned.
+static uint32_t asyncDoneCount;
+static bool asyncFailed;
+
+static void asyncWriteDone(uint32_t seqNum, bool success) {
+  (void)seqNum;
+  asyncDoneCount++;
+  asyncFailed |= !success;
+}
+#endif  // JAZASD_ENABLE_ASYNC_WRITES
+//------------------------------------------------------------------------------
+static void benchJazaSD() {
+  char name[40];
+  char row[80];
+
+  meterBegin("jazaSD.begin");
+  jazaSD.begin();
+  CHECK(SD_INITIALIZED);
+  meterEnd(1);
+
+  const uint32_t numRows = 2000;
+  meterBegin("fileEntry");
+  for (uint32_t n = 0; n < numRows; n++) {
+    makeRow(row, sizeof(row), n);
+    CHECK(jazaSD.fileEntry(FILE_PUBLISH_HISTORY, row));
+  }
+  meterEnd(numRows);
+
+  meterBegin("getEntry random");
+  for (int k = 0; k < 200; k++) {
+    uint32_t n = rng(numRows);
+    const char* entry = jazaSD.getEntry(FILE_PUBLISH_HISTORY, n);
+    snprintf(name, sizeof(name), ",key%lu,", (unsigned long)n);
+    CHECK(entry && strstr(entry, name));
+  }
+  meterEnd(200);
+
+  meterBegin("searchGetEntry random");
+  for (int k = 0; k < 50; k++) {
+    uint32_t n = rng(numRows);
+    snprintf(name, sizeof(name), "key%lu,", (unsigned long)n);
+    CHECK(jazaSD.searchGetEntry(FILE_PUBLISH_HISTORY, name, 1));
+  }
+  meterEnd(50);
+
+#if JAZASD_ENABLE_ASYNC_WRITES
+  // The worker thread writes the rows while fileEntry() returns at once;
+  // flush() waits for the last one.
+  meterBegin("fileEntry queued");
+  CHECK(jazaSD.setAsyncWrites(true, asyncWriteDone));
+  for (uint32_t n = numRows; n < 2*numRows; n++) {
+    makeRow(row, sizeof(row), n);
+    CHECK(jazaSD.fileEntry(FILE_PUBLISH_HISTORY, row));
+  }
+  uint32_t lastWrite = jazaSD.lastQueuedWrite();
+  CHECK(jazaSD.flush());
+  CHECK(jazaSD.writeDone(lastWrite));
+  CHECK(asyncDoneCount == numRows && !asyncFailed);
+  CHECK(jazaSD.setAsyncWrites(false));
+  meterEnd(numRows);
+  for (uint32_t n = numRows; n < 2*numRows; n += 97) {
+    const char* entry = jazaSD.getEntry(FILE_PUBLISH_HISTORY, n);
+    snprintf(name, sizeof(name), ",key%lu,", (unsigned long)n);
+    CHECK(entry && strstr(entry, name));
+  }
+#endif  // JAZASD_ENABLE_ASYNC_WRITES
+
+  // userTable.csv is a fixed width file, so every row has the same length
+  // and replaceEntry() overwrites in place.
+  const uint32_t sizes[] = {100, 1000, 4000};
+  for (size_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++) {
+    CHECK(jazaSD.wipeFile(FILE_USERTABLE));
+    for (uint32_t n = 0; n < sizes[i]; n++) {
+      snprintf(row, sizeof(row), "%06lu,user %06lu,original",
+               (unsigned long)n, (unsigned long)rng(1000000));
+      CHECK(jazaSD.fileEntry(FILE_USERTABLE, row));
+    }
+    CHECK(sd.vol()->cacheClear());
+    snprintf(name, sizeof(name), "replaceEntry %lu rows",
+             (unsigned long)sizes[i]);
+    meterBegin(name);
+    for (int k = 0; k < 20; k++) {
+      uint32_t n = rng(sizes[i]);
+      snprintf(row, sizeof(row), "%06lu,user %06lu,replaced",
+               (unsigned long)n, (unsigned long)rng(1000000));
+      CHECK(jazaSD.replaceEntry(FILE_USERTABLE, n, row));
+    }
+    meterEnd(20);
+  }
+
+  meterBegin("archiveFiles");
+  for (int k = 0; k < 5; k++) {
+    the_time += 3600;
+    CHECK(jazaSD.archiveFiles());
+  }
+  meterEnd(5);
+
+  // Mark the FSINFO free count unknown and mount again.  Each retention
+  // tick must then read a slice of the FAT, never the whole of it.
+  uint8_t block[512];
+  CHECK(sd.vol()->cacheClear());
+  CHECK(sd.card()->readBlock(1, block));
+  memset(block + 488, 0XFF, 4);
+  CHECK(sd.card()->writeBlock(1, block));
+  CHECK(sd.card()->syncBlocks());
+  CHECK(remount());
+  CHECK(!sd.vol()->freeClusterCountKnown());
+  jazaSD.setArchiveRetention(0, 1);
+  meterBegin("retention ticks, free count unknown");
+  uint32_t ticks = 0;
+  while (!sd.vol()->freeClusterCountKnown()) {
+    uint32_t blocks = sd.vol()->blockReadCount();
+    CHECK(jazaSD.serviceArchiveRetention());
+    CHECK(sd.vol()->blockReadCount() - blocks <= 2*FAT_SCAN_BLOCKS_PER_STEP);
+    ticks++;
+  }
+  meterEnd(ticks);
+  jazaSD.setArchiveRetention(0, 0);
+}
+//------------------------------------------------------------------------------
+static void benchFatLib() {
+  static uint8_t buf[4096];
+  char name[64];
+  FatFile file;
+  FatFile dir;
+
+  memset(buf, 'x', sizeof(buf));
+  CHECK(sd.mkdir("bench"));
+  CHECK(sd.vol()->cacheClear());
+
+  meterBegin("create/append/remove 20 files");
+  for (int r = 0; r < 8; r++) {
+    for (int i = 0; i < 20; i++) {
+      snprintf(name, sizeof(name), "bench/append file %02d.bin", i);
+      CHECK(file.open(sd.vwd(), name, O_RDWR | O_CREAT | O_AT_END));
+      CHECK(file.write(buf, 1000 + rng(3000)) > 0);
+      CHECK(file.close());
+    }
+  }
+  for (int i = 0; i < 20; i += 2) {
+    snprintf(name, sizeof(name), "bench/append file %02d.bin", i);
+    CHECK(sd.remove(name));
+  }
+  meterEnd(180);
+
+  CHECK(sd.mkdir("bench/names"));
+  for (int i = 0; i < 200; i++) {
+    snprintf(name, sizeof(name), "bench/names/filler file number %03d.csv", i);
+    CHECK(file.open(sd.vwd(), name, O_RDWR | O_CREAT));
+    CHECK(file.close());
+  }
+  for (int i = 0; i < 13; i++) {
+    snprintf(name, sizeof(name), "bench/names/Jaza File %02d.csv", i);
+    CHECK(file.open(sd.vwd(), name, O_RDWR | O_CREAT));
+    CHECK(file.close());
+  }
+  CHECK(sd.vol()->cacheClear());
+  meterBegin("LFN open 13 of 213 files");
+  for (int k = 0; k < 100; k++) {
+    for (int i = 0; i < 13; i++) {
+      snprintf(name, sizeof(name), "bench/names/Jaza File %02d.csv", i);
+      CHECK(file.open(sd.vwd(), name, O_RDWR));
+      CHECK(file.close());
+    }
+  }
+  meterEnd(1300);
+
+  // Grow the files of five folders in turn so their chains interleave.
+  CHECK(sd.mkdir("bench/tree"));
+  for (int pass = 0; pass < 2; pass++) {
+    for (int r = 0; r < 12; r++) {
+      for (int a = 0; a < 5; a++) {
+        snprintf(name, sizeof(name), "bench/tree/%d", 1500000000 + a);
+        if (!sd.exists(name)) {
+          CHECK(sd.mkdir(name));
+        }
+        snprintf(name, sizeof(name), "bench/tree/%d/file number %d.csv",
+                 1500000000 + a, r);
+        CHECK(file.open(sd.vwd(), name, O_RDWR | O_CREAT | O_AT_END));
+        CHECK(file.write(buf, 1000 + rng(3000)) > 0);
+        CHECK(file.close());
+      }
+    }
+  }
+  CHECK(sd.vol()->cacheClear());
+  meterBegin("rmRfStar 5 fragmented folders");
+  CHECK(dir.open(sd.vwd(), "bench/tree", O_READ));
+  CHECK(dir.rmRfStar());
+  meterEnd(5);
+
+  meterBegin("synced log rows");
+  CHECK(file.open(sd.vwd(), "bench/log.csv", O_RDWR | O_CREAT | O_AT_END));
+  for (uint32_t n = 0; n < 500; n++) {
+    int len = makeRow(name, sizeof(name), n);
+    CHECK(file.write(name, len) == len && file.write("\r\n", 2) == 2);
+    CHECK(file.sync());
+  }
+  CHECK(file.close());
+  meterEnd(500);
+
+  meterBegin("StdioStream CSV rows");
+  StdioStream stream;
+  CHECK(stream.fopen("bench/stdio.csv", "w"));
+  for (uint32_t n = 0; n < 200000; n++) {
+    stream.printDec(n);
+    stream.putc(',');
+    stream.printDec((int32_t)(n*7919 % 100003) - 50000);
+    stream.putc(',');
+    stream.printHex(n*2654435761UL);
+    stream.fputs(",text");
+    stream.putCRLF();
+  }
+  CHECK(stream.fclose() == 0);
+  meterEnd(200000);
+
+  meterBegin("mount + freeClusterCount");
+  CHECK(remount());
+  CHECK(sd.vol()->freeClusterCount() > 0);
+  meterEnd(1);
+}
+//------------------------------------------------------------------------------
+#if !JAZASD_HOST_IMAGE && USE_ASYNC_BLOCK_IO
+// A sync must not return until the last writeBlockStart() has programmed,
+// and must report a program failure the card shows in CMD13.  A command
+// sent while a readBlocksStart() is in progress must finish the read first.
+static void checkAsyncIo() {
+  static uint8_t buf[3*512];
+  uint8_t block[512];
+  FatFile file;
+  CHECK(file.open(sd.vwd(), "async.bin", O_RDWR | O_CREAT | O_TRUNC));
+  CHECK(file.write("first", 5) == 5);
+  CHECK(file.sync());
+  CHECK(!hostSdCard.busy());
+  CHECK(file.write("second", 6) == 6);
+  hostSdCard.failNextStatus();
+  CHECK(!file.sync());
+  CHECK(sd.card()->errorCode());
+  CHECK(file.close());
+  CHECK(sd.remove("async.bin"));
+
+  CHECK(sd.card()->readBlocksStart(0, buf, 3));
+  CHECK(sd.card()->readBlock(1, block));
+  CHECK(memcmp(block, buf + 512, 512) == 0);
+  CHECK(sd.card()->readBlocksStart(0, buf, 3));
+  CHECK(sd.card()->syncBlocks());
+  CHECK(sd.card()->readBlock(2, block));
+  CHECK(memcmp(block, buf + 1024, 512) == 0);
+  printf("async I/O checks passed\n\n");
+}
+#endif  // !JAZASD_HOST_IMAGE && USE_ASYNC_BLOCK_IO
+//------------------------------------------------------------------------------
+int main(int argc, char** argv) {
+  uint32_t mb = argc > 1 ? atoi(argv[1]) : 1024;
+  uint32_t spc = argc > 2 ? atoi(argv[2]) : 8;
+
+  makeImage(JAZASD_HOST_IMAGE_PATH, mb, spc);
+#if JAZASD_HOST_IMAGE
+  printf("image %s %u MB, %u blocks per cluster\n", JAZASD_HOST_IMAGE_PATH,
+         mb, spc);
+#else  // JAZASD_HOST_IMAGE
+  CHECK(hostSdCard.begin(JAZASD_HOST_IMAGE_PATH, SD_CHIPSELECT));
+  printf("SPI card %s %u MB, %u blocks per cluster, USE_SD_CRC %d "
+         "CHECK_FLASH_PROGRAMMING %d\n", JAZASD_HOST_IMAGE_PATH, mb, spc,
+         USE_SD_CRC, CHECK_FLASH_PROGRAMMING);
+#endif  // JAZASD_HOST_IMAGE
+  printf("FAT_CACHE_BLOCK_COUNT %d FAT_READ_AHEAD_BLOCKS %d "
+         "USE_FAT_EXTENT_CACHE %d FAT_NAME_CACHE_SIZE %d\n",
+         FAT_CACHE_BLOCK_COUNT, FAT_READ_AHEAD_BLOCKS, USE_FAT_EXTENT_CACHE,
+         FAT_NAME_CACHE_SIZE);
+  printf("FAT_FREE_BATCH_SIZE %d FAT_FREE_MAP_BYTES %d FAT_DIR_SYNC_LAG %d "
+         "FAT_MIRROR_MODE %d STDIO_STREAM_BUF_SIZE %d USE_FSINFO_FREE_COUNT %d"
+         "\n\n", FAT_FREE_BATCH_SIZE, FAT_FREE_MAP_BYTES, FAT_DIR_SYNC_LAG,
+         FAT_MIRROR_MODE, STDIO_STREAM_BUF_SIZE, USE_FSINFO_FREE_COUNT);
+#if !JAZASD_HOST_IMAGE && USE_ASYNC_BLOCK_IO
+  CHECK(remount());
+  checkAsyncIo();
+#endif  // !JAZASD_HOST_IMAGE && USE_ASYNC_BLOCK_IO
+#if SD_TIMING
+  const SdTimingModel* m = sd.timing()->model();
+  printf("SdTimingCard command %lu us, read %lu us/block, write %lu us/block,"
+         " busy %lu us, AU %lu blocks, AU cross %lu us\n\n",
+         (unsigned long)m->commandMicros, (unsigned long)m->readBlockMicros,
+         (unsigned long)m->writeBlockMicros, (unsigned long)m->writeBusyMicros,
+         (unsigned long)m->auBlocks, (unsigned long)m->auCrossMicros);
+  printf("%-34s %7s %9s %8s %9s %8s %10s %12s %8s %8s\n", "scenario", "ops",
+         "rdBlocks", "rdCmds", "wrBlocks", "wrCmds", "us", "virtUs",
+         "virtCmds", "auCross");
+#elif JAZASD_HOST_IMAGE
+  printf("%-34s %7s %9s %8s %9s %8s %10s\n", "scenario", "ops", "rdBlocks",
+         "rdCmds", "wrBlocks", "wrCmds", "us");
+#elif JAZASD_USE_SD_EX
+  printf("%-34s %7s %9s %8s %9s %8s %8s %9s %10s %8s %8s\n", "scenario",
+         "ops", "rdBlocks", "rdCmds", "wrBlocks", "wrCmds", "allCmds",
+         "spiXfers", "us", "exCmds", "exSaved");
+#else  // JAZASD_HOST_IMAGE
+  printf("%-34s %7s %9s %8s %9s %8s %8s %9s %10s\n", "scenario", "ops",
+         "rdBlocks", "rdCmds", "wrBlocks", "wrCmds", "allCmds", "spiXfers",
+         "us");
+#endif  // JAZASD_HOST_IMAGE
+  benchJazaSD();
+  benchFatLib();
+  return 0;
+}
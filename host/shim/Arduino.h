@@ -0,0 +1,138 @@
+/* Host build shim: the Arduino/Particle wiring API used by SdFat and JazaSD.
+ * Output goes to stdout, pins and delays do nothing.
+ */
+#ifndef HOST_Arduino_h
+#define HOST_Arduino_h
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define MSBFIRST 1
+#define SPI_MODE0 0
+#define MHZ 1000000
+#define HEX 16
+#define DEC 10
+#define SS 10
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+/** Just enough of String for the SdFat overloads that take one. */
+class String {
+ public:
+  String(const char* str = "") : m_str(str) {}
+  const char* c_str() const {
+    return m_str;
+  }
+  unsigned length() const {
+    return strlen(m_str);
+  }
+
+ private:
+  const char* m_str;
+};
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void pinMode(uint16_t pin, uint8_t mode);
+void digitalWrite(uint16_t pin, uint8_t value);
+int32_t digitalRead(uint16_t pin);
+void yield();
+
+#define ATOMIC_BLOCK() for (int atomicOnce = 1; atomicOnce; atomicOnce = 0)
+#define SINGLE_THREADED_BLOCK() ATOMIC_BLOCK()
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t b) = 0;
+  virtual size_t write(const uint8_t* buf, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      write(buf[i]);
+    }
+    return n;
+  }
+  size_t write(const char* str) {
+    return write(reinterpret_cast<const uint8_t*>(str), strlen(str));
+  }
+  virtual void flush() {}
+  size_t print(const char* str) {
+    return write(str);
+  }
+  size_t print(char c) {
+    return write((uint8_t)c);
+  }
+  size_t print(int n, int base = DEC) {
+    return print((long)n, base);
+  }
+  size_t print(unsigned n, int base = DEC) {
+    return print((unsigned long)n, base);
+  }
+  size_t print(long n, int base = DEC) {
+    return printf(base == HEX ? "%lX" : "%ld", n);
+  }
+  size_t print(unsigned long n, int base = DEC) {
+    return printf(base == HEX ? "%lX" : "%lu", n);
+  }
+  size_t print(double n, int digits = 2) {
+    return printf("%.*f", digits, n);
+  }
+  size_t println() {
+    return write("\r\n");
+  }
+  template<typename T> size_t println(T value) {
+    return print(value) + println();
+  }
+  template<typename T> size_t println(T value, int base) {
+    return print(value, base) + println();
+  }
+  size_t printf(const char* format, ...)
+    __attribute__((format(printf, 2, 3)));
+  size_t printlnf(const char* format, ...)
+    __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+};
+
+/** Serial port on stdout. */
+class HostSerial : public Stream {
+ public:
+  void begin(uint32_t) {}
+  size_t write(uint8_t b) {
+    return putchar(b) == EOF ? 0 : 1;
+  }
+  using Print::write;
+  void flush() {
+    fflush(stdout);
+  }
+  int available() {
+    return 0;
+  }
+  int read() {
+    return -1;
+  }
+  int peek() {
+    return -1;
+  }
+  operator bool() {
+    return true;
+  }
+};
+extern HostSerial Serial;
+
+#include "SPI.h"
+#endif  // HOST_Arduino_h
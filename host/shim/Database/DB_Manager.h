@@ -0,0 +1 @@
+/* Host build shim: JazaSD doesn't use the database manager directly. */
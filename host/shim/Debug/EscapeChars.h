@@ -0,0 +1,6 @@
+/* Host build shim: printable copies of strings with control characters. */
+#ifndef HOST_EscapeChars_h
+#define HOST_EscapeChars_h
+const char* getEscapedCharString(char c);
+const char* getEscapedStr(const char* str);
+#endif  // HOST_EscapeChars_h
@@ -0,0 +1,33 @@
+/* Host build shim: log helpers and the message strings JazaSD uses. */
+#ifndef HOST_PrintHelper_h
+#define HOST_PrintHelper_h
+#include "application.h"
+
+void printError(const Logger& log, unsigned lineNum, const char* mes,
+                const char* detail = NULL);
+void printWarning(const Logger& log, unsigned lineNum, const char* mes,
+                  const char* detail = NULL);
+void printInfo(const Logger& log, unsigned lineNum, const char* mes,
+               const char* detail = NULL);
+void printTrace(const Logger& log, unsigned lineNum, const char* mes,
+                const char* detail = NULL);
+void printHeaderBreak(const char* title);
+void printFreeMem();
+
+extern const char* mes_obj_sd;
+extern const char* mes_buf_Small;
+extern const char* mes_err_sanity;
+extern const char* mes_err_thrown;
+extern const char* mes_err_unknown;
+extern const char* mes_gen_success;
+extern const char* mes_inValid;
+extern const char* mes_sd_fileOpenError;
+extern const char* mes_sd_fileSeekError;
+extern const char* mes_sd_noEntries;
+extern const char* mes_sd_overWritingBytes;
+extern const char* mes_sd_readError;
+extern const char* mes_sd_syncError;
+extern const char* mes_sd_truncating;
+extern const char* mes_sd_variableWidth;
+extern const char* mes_sd_writeError;
+#endif  // HOST_PrintHelper_h
@@ -0,0 +1,363 @@
+/* Host build shim: SPI mode SD card backed by an image file. */
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "HostSdCard.h"
+
+HostSdCard hostSdCard;
+//------------------------------------------------------------------------------
+static uint8_t crc7(const uint8_t* data, size_t n) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < n; i++) {
+    uint8_t d = data[i];
+    for (uint8_t j = 0; j < 8; j++) {
+      crc <<= 1;
+      if ((d & 0X80) ^ (crc & 0X80)) {
+        crc ^= 0X09;
+      }
+      d <<= 1;
+    }
+  }
+  return (crc << 1) | 1;
+}
+static uint16_t crc16(const uint8_t* data, size_t n) {
+  uint16_t crc = 0;
+  for (size_t i = 0; i < n; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t j = 0; j < 8; j++) {
+      crc = crc & 0X8000 ? (crc << 1) ^ 0X1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+//------------------------------------------------------------------------------
+bool HostSdCard::begin(const char* path, uint16_t csPin) {
+  struct stat st;
+  end();
+  m_fd = open(path, O_RDWR);
+  if (m_fd < 0 || fstat(m_fd, &st)) {
+    end();
+    return false;
+  }
+  m_blockCount = st.st_size/512;
+  m_csPin = csPin;
+  m_selected = false;
+  m_idle = true;
+  m_appCmd = false;
+  m_crcOn = false;
+  m_failStatus = false;
+  m_state = STATE_IDLE;
+  m_cmdCount = 0;
+  clearOut();
+  m_busy = 0;
+  resetCounters();
+  return true;
+}
+//------------------------------------------------------------------------------
+void HostSdCard::end() {
+  if (m_fd >= 0) {
+    close(m_fd);
+  }
+  m_fd = -1;
+}
+//------------------------------------------------------------------------------
+void HostSdCard::resetCounters() {
+  memset(&m_count, 0, sizeof(m_count));
+}
+//------------------------------------------------------------------------------
+void HostSdCard::pinWrite(uint16_t pin, uint8_t value) {
+  if (pin != m_csPin) {
+    return;
+  }
+  m_selected = !value;
+  if (!m_selected) {
+    // a deselect ends any response in progress, programming carries on
+    m_cmdCount = 0;
+    if (m_state != STATE_READ_MULTIPLE) {
+      clearOut();
+    }
+  }
+}
+//------------------------------------------------------------------------------
+void HostSdCard::clearOut() {
+  m_outHead = m_outTail = 0;
+  m_tokenIndex = NO_TOKEN;
+}
+//------------------------------------------------------------------------------
+void HostSdCard::push(uint8_t b) {
+  if (m_outHead == m_outTail) {
+    clearOut();
+  }
+  if (m_outTail < sizeof(m_out)) {
+    m_out[m_outTail++] = b;
+  }
+}
+//------------------------------------------------------------------------------
+// start token, data and CRC after one byte of access time
+void HostSdCard::pushData(const uint8_t* src, size_t n, bool block) {
+  uint16_t crc = crc16(src, n);
+  push(0XFF);
+  if (block) {
+    // count the block once the host reads its token, not when prefetched
+    m_tokenIndex = m_outTail;
+  }
+  push(0XFE);
+  for (size_t i = 0; i < n; i++) {
+    push(src[i]);
+  }
+  push(crc >> 8);
+  push(crc & 0XFF);
+}
+//------------------------------------------------------------------------------
+// one byte of command response time then the R1 status
+void HostSdCard::r1(uint8_t status) {
+  push(0XFF);
+  push(status | (m_idle ? 0X01 : 0));
+}
+//------------------------------------------------------------------------------
+bool HostSdCard::readImage(uint32_t lba, uint8_t* dst) {
+  if (lba >= m_blockCount ||
+      pread(m_fd, dst, 512, (off_t)lba*512) != 512) {
+    return false;
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+bool HostSdCard::writeImage(uint32_t lba, const uint8_t* src) {
+  if (lba >= m_blockCount ||
+      pwrite(m_fd, src, 512, (off_t)lba*512) != 512) {
+    return false;
+  }
+  m_count.writeBlocks++;
+  return true;
+}
+//------------------------------------------------------------------------------
+uint8_t HostSdCard::exchange(uint8_t in) {
+  if (!m_selected) {
+    return 0XFF;
+  }
+  m_count.bytes++;
+  uint8_t out = 0XFF;
+  if (m_outHead != m_outTail) {
+    // a command clocking out the token of a prefetched block doesn't count
+    if (m_outHead == m_tokenIndex && in == 0XFF && !m_cmdCount) {
+      m_count.readBlocks++;
+      m_tokenIndex = NO_TOKEN;
+    }
+    out = m_out[m_outHead++];
+  } else if (m_busy) {
+    m_busy--;
+    out = 0;
+  } else if (m_state == STATE_READ_MULTIPLE && in == 0XFF && !m_cmdCount) {
+    // the host is waiting for the next block's start token
+    uint8_t buf[512];
+    if (readImage(m_lba, buf)) {
+      m_lba++;
+      pushData(buf, 512, true);
+    } else {
+      push(0X08);    // data error token, out of range
+    }
+    out = m_out[m_outHead++];
+  }
+
+  if (m_state == STATE_WRITE_TOKEN && !m_busy && m_outHead == m_outTail) {
+    if (in == 0XFE || (m_writeMultiple && in == 0XFC)) {
+      m_state = STATE_WRITE_DATA;
+      m_dataCount = 0;
+    } else if (m_writeMultiple && in == 0XFD) {
+      // stop tran, one byte then busy while the card finishes
+      m_state = STATE_IDLE;
+      push(0XFF);
+      m_busy = m_busyBytes;
+    }
+    return out;
+  }
+  if (m_state == STATE_WRITE_DATA) {
+    m_data[m_dataCount++] = in;
+    if (m_dataCount == sizeof(m_data)) {
+      writeDone();
+    }
+    return out;
+  }
+  // command bytes start with 01 in the top two bits
+  if (m_cmdCount || (in & 0XC0) == 0X40) {
+    m_cmd[m_cmdCount++] = in;
+    if (m_cmdCount == 6) {
+      m_cmdCount = 0;
+      command();
+    }
+  }
+  return out;
+}
+//------------------------------------------------------------------------------
+void HostSdCard::writeDone() {
+  uint16_t crc = (uint16_t)m_data[512] << 8 | m_data[513];
+  m_state = m_writeMultiple ? STATE_WRITE_TOKEN : STATE_IDLE;
+  if (m_crcOn && crc != crc16(m_data, 512)) {
+    m_count.crcErrors++;
+    push(0X0B);
+    m_state = STATE_IDLE;
+    return;
+  }
+  if (!writeImage(m_lba, m_data)) {
+    push(0X0D);
+    m_state = STATE_IDLE;
+    return;
+  }
+  m_lba++;
+  push(0X05);
+  m_busy = m_busyBytes;
+}
+//------------------------------------------------------------------------------
+void HostSdCard::command() {
+  uint8_t cmd = m_cmd[0] & 0X3F;
+  uint32_t arg = (uint32_t)m_cmd[1] << 24 | (uint32_t)m_cmd[2] << 16 |
+                 (uint32_t)m_cmd[3] << 8 | m_cmd[4];
+  bool appCmd = m_appCmd;
+  m_appCmd = false;
+  m_count.commands++;
+  clearOut();
+
+  if (cmd == 12) {
+    // stop transmission, the host skips a stuff byte
+    m_state = STATE_IDLE;
+    push(0XFF);
+    r1(0);
+    m_busy = 1;
+    return;
+  }
+  // CRC is always checked for CMD0 and CMD8, and for every command after CMD59
+  if ((m_crcOn || cmd == 0 || cmd == 8) && crc7(m_cmd, 5) != m_cmd[5]) {
+    m_count.crcErrors++;
+    r1(0X08);
+    return;
+  }
+  if (appCmd) {
+    switch (cmd) {
+      case 13: {
+        // SD status, R2 then a 64 byte data block
+        uint8_t status[64];
+        memset(status, 0, sizeof(status));
+        r1(0);
+        push(0);
+        pushData(status, sizeof(status));
+        return;
+      }
+      case 23:
+        r1(0);
+        return;
+      case 41:
+        // still idle the first time, like a card that takes a while to start
+        r1(0);
+        m_idle = false;
+        return;
+    }
+  }
+  switch (cmd) {
+    case 0:
+      m_idle = true;
+      m_crcOn = false;
+      m_state = STATE_IDLE;
+      r1(0);
+      break;
+    case 8:
+      r1(0);
+      push(0);
+      push(0);
+      push(arg >> 8 & 0X0F);
+      push(arg & 0XFF);
+      break;
+    case 9: {
+      // CSD version 2 with C_SIZE from the image size
+      uint8_t csd[16] = {0X40, 0X0E, 0X00, 0X32, 0X5B, 0X59, 0X00, 0, 0, 0,
+                         0X7F, 0X80, 0X0A, 0X40, 0X00, 0};
+      uint32_t cSize = m_blockCount/1024 - 1;
+      csd[7] = cSize >> 16 & 0X3F;
+      csd[8] = cSize >> 8;
+      csd[9] = cSize;
+      csd[15] = crc7(csd, 15);
+      r1(0);
+      pushData(csd, sizeof(csd));
+      break;
+    }
+    case 10: {
+      uint8_t cid[16] = {0X03, 'S', 'D', 'H', 'O', 'S', 'T', 'S', 0X10,
+                         0, 0, 0, 1, 0X01, 0X12, 0};
+      cid[15] = crc7(cid, 15);
+      r1(0);
+      pushData(cid, sizeof(cid));
+      break;
+    }
+    case 13:
+      m_count.statusCmds++;
+      r1(0);
+      push(m_failStatus ? 0X04 : 0);
+      m_failStatus = false;
+      break;
+    case 17: {
+      uint8_t buf[512];
+      m_count.readCmds++;
+      if (arg >= m_blockCount) {
+        r1(0X40);
+        break;
+      }
+      r1(0);
+      if (readImage(arg, buf)) {
+        pushData(buf, 512, true);
+      } else {
+        push(0X08);
+      }
+      break;
+    }
+    case 18:
+      m_count.readCmds++;
+      if (arg >= m_blockCount) {
+        r1(0X40);
+        break;
+      }
+      r1(0);
+      m_lba = arg;
+      m_state = STATE_READ_MULTIPLE;
+      break;
+    case 24:
+    case 25:
+      m_count.writeCmds++;
+      if (arg >= m_blockCount) {
+        r1(0X40);
+        break;
+      }
+      r1(0);
+      m_lba = arg;
+      m_writeMultiple = cmd == 25;
+      m_state = STATE_WRITE_TOKEN;
+      break;
+    case 32:
+    case 33:
+      r1(0);
+      break;
+    case 38:
+      r1(0);
+      m_busy = m_busyBytes;
+      break;
+    case 55:
+      m_appCmd = true;
+      r1(0);
+      break;
+    case 58:
+      // OCR, powered up and high capacity
+      r1(0);
+      push(0XC0);
+      push(0XFF);
+      push(0X80);
+      push(0X00);
+      break;
+    case 59:
+      m_crcOn = arg & 1;
+      r1(0);
+      break;
+    default:
+      r1(0X04);
+      break;
+  }
+}
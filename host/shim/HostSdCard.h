@@ -0,0 +1,107 @@
+/* Host build shim: an SDHC card on the SPI bus, backed by an image file.
+ *
+ * SPIClass hands every byte clocked while the card is selected to
+ * HostSdCard::exchange(), so SdSpiCard and SdSpiCardEX run unchanged on
+ * the host.  The card answers the SPI mode commands SdSpiCard uses, checks
+ * and sends CRCs once CMD59 turns them on, and counts commands, blocks and
+ * SPI transfers so the bench can report what the card layer costs.
+ */
+#ifndef HOST_HostSdCard_h
+#define HOST_HostSdCard_h
+#include <stdint.h>
+#include <stddef.h>
+
+/** Operation counts since begin() or resetCounters(). */
+struct HostSdCounters {
+  uint32_t commands;     // every command, ACMD prefix CMD55 included
+  uint32_t readCmds;     // CMD17 and CMD18
+  uint32_t readBlocks;
+  uint32_t writeCmds;    // CMD24 and CMD25
+  uint32_t writeBlocks;
+  uint32_t statusCmds;   // CMD13
+  uint32_t transfers;    // SPIClass transfer calls, byte or bulk
+  uint32_t bytes;        // bytes clocked with the card selected
+  uint32_t crcErrors;    // commands or data blocks with a bad CRC
+};
+
+class HostSdCard {
+ public:
+  /** Open the image and reset the card to its power on state.
+   * \param[in] path image file.
+   * \param[in] csPin chip select pin the driver writes.
+   * \return true for success.
+   */
+  bool begin(const char* path, uint16_t csPin);
+  /** Close the image. */
+  void end();
+  /** Exchange one byte with the card. */
+  uint8_t exchange(uint8_t in);
+  /** Track the chip select pin. */
+  void pinWrite(uint16_t pin, uint8_t value);
+  /** Count one SPIClass transfer call. */
+  void countTransfer() {
+    m_count.transfers++;
+  }
+  /** Bytes of busy after each block is programmed, 0X00 is sent. */
+  void busyBytes(uint16_t n) {
+    m_busyBytes = n;
+  }
+  /** Make the next CMD13 report an error, as a failed program would. */
+  void failNextStatus() {
+    m_failStatus = true;
+  }
+  /** \return true while a block is programming. */
+  bool busy() const {
+    return m_busy != 0;
+  }
+  const HostSdCounters& counters() const {
+    return m_count;
+  }
+  void resetCounters();
+  bool selected() const {
+    return m_selected;
+  }
+
+ private:
+  enum {
+    STATE_IDLE,
+    STATE_READ_MULTIPLE,
+    STATE_WRITE_TOKEN,
+    STATE_WRITE_DATA
+  };
+  static const uint16_t NO_TOKEN = 0XFFFF;
+  void clearOut();
+  void command();
+  void push(uint8_t b);
+  void pushData(const uint8_t* src, size_t n, bool block = false);
+  void r1(uint8_t status);
+  bool readImage(uint32_t lba, uint8_t* dst);
+  bool writeImage(uint32_t lba, const uint8_t* src);
+  void writeDone();
+
+  int m_fd = -1;
+  uint32_t m_blockCount = 0;
+  uint16_t m_csPin = 0XFFFF;
+  bool m_selected = false;
+  bool m_idle = true;
+  bool m_appCmd = false;
+  bool m_crcOn = false;
+  bool m_failStatus = false;
+  uint8_t m_state = STATE_IDLE;
+  bool m_writeMultiple = false;
+  uint32_t m_lba = 0;
+  uint8_t m_cmd[6];
+  uint8_t m_cmdCount = 0;
+  uint8_t m_data[514];
+  uint16_t m_dataCount = 0;
+  // bytes waiting to be clocked out
+  uint8_t m_out[600];
+  uint16_t m_outHead = 0;
+  uint16_t m_outTail = 0;
+  uint16_t m_tokenIndex = NO_TOKEN;
+  uint16_t m_busy = 0;
+  uint16_t m_busyBytes = 8;
+  HostSdCounters m_count;
+};
+extern HostSdCard hostSdCard;
+#endif  // HOST_HostSdCard_h
@@ -0,0 +1 @@
+/* Host build shim: no lab equipment on the host. */
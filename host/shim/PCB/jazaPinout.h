@@ -0,0 +1,6 @@
+/* Host build shim: pins JazaSD drives. */
+#ifndef HOST_jazaPinout_h
+#define HOST_jazaPinout_h
+#define SD_POWER_ENABLE 1
+#define SD_CHIPSELECT 2
+#endif  // HOST_jazaPinout_h
@@ -0,0 +1,23 @@
+/* Host build shim: JazaSD's SD error warnings are printed, not published. */
+#ifndef HOST_JazaPublish_h
+#define HOST_JazaPublish_h
+#include <stdint.h>
+
+#define MIN_MS_BEFORE_SD_WRITE_AFTER_PUBLISH 1000
+enum {
+  WARNPUB_SD_ERROR
+};
+
+class HostPublish {
+ public:
+  bool publishWarning(const char* object, unsigned lineNum, const char* data,
+                      bool blocking, int warnType, bool saveToSD);
+};
+extern HostPublish jazaPublish;
+
+class HostTimer {
+ public:
+  uint32_t elapsedTime();
+};
+extern HostTimer lastPublishTimer;
+#endif  // HOST_JazaPublish_h
@@ -0,0 +1,6 @@
+/* Host build shim: retained RAM variables JazaSD reads. */
+#ifndef HOST_RetainedVars_h
+#define HOST_RetainedVars_h
+extern bool SD_RECOVERY_ATTEMPT_ACTIVE;
+extern bool SRAM_COLD_BOOT;
+#endif  // HOST_RetainedVars_h
@@ -0,0 +1,2 @@
+/* Host build shim: JazaSD includes SdFat from the app's library folder. */
+#include "../../../../SdFat/SdFat.h"
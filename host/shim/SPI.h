@@ -0,0 +1,50 @@
+/* Host build shim: SPI bus with HostSdCard as the only device. */
+#ifndef HOST_SPI_h
+#define HOST_SPI_h
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "HostSdCard.h"
+
+class SPISettings {
+ public:
+  SPISettings() {}
+  SPISettings(uint32_t, uint8_t, uint8_t) {}
+};
+typedef void (*wiring_spi_dma_transfercomplete_callback_t)(void);
+
+class SPIClass {
+ public:
+  void begin() {}
+  void begin(uint16_t) {}
+  int32_t beginTransaction(const SPISettings&) {
+    return 0;
+  }
+  void endTransaction() {}
+  uint8_t transfer(uint8_t data) {
+    hostSdCard.countTransfer();
+    return hostSdCard.exchange(data);
+  }
+  /** Bulk transfer, a null tx sends 0XFF.  The callback, if any, runs
+   * before this returns since the host has no DMA.
+   */
+  void transfer(const void* tx, void* rx, size_t n,
+                wiring_spi_dma_transfercomplete_callback_t callback) {
+    const uint8_t* src = static_cast<const uint8_t*>(tx);
+    uint8_t* dst = static_cast<uint8_t*>(rx);
+    hostSdCard.countTransfer();
+    for (size_t i = 0; i < n; i++) {
+      uint8_t b = hostSdCard.exchange(src ? src[i] : 0XFF);
+      if (dst) {
+        dst[i] = b;
+      }
+    }
+    if (callback) {
+      callback();
+    }
+  }
+  void transferCancel() {}
+};
+extern SPIClass SPI;
+extern SPIClass SPI1;
+#endif  // HOST_SPI_h
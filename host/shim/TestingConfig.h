@@ -0,0 +1 @@
+/* Host build shim: no TEST_MODE options, pass them with DEFS instead. */
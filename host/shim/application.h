@@ -0,0 +1,108 @@
+/* Host build shim: the parts of the Particle Device OS API used by SdFat
+ * and JazaSD.  Thread, Mutex and the os_semaphore calls run on std::thread,
+ * so JazaSD's async write worker runs for real (link with -pthread).
+ */
+#ifndef HOST_application_h
+#define HOST_application_h
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "Arduino.h"
+
+#define OS_THREAD_PRIORITY_DEFAULT 2
+typedef void (*wiring_thread_fn_t)(void* param);
+typedef uint32_t system_tick_t;
+
+class Thread {
+ public:
+  Thread() {}
+  Thread(const char*, wiring_thread_fn_t fn, void* param = NULL,
+         int = OS_THREAD_PRIORITY_DEFAULT, size_t = 3072)
+    : m_thread(fn, param) {}
+  bool isCurrent() {
+    return m_thread.get_id() == std::this_thread::get_id();
+  }
+
+ private:
+  std::thread m_thread;
+};
+
+class Mutex {
+ public:
+  void lock() {
+    m_mutex.lock();
+  }
+  bool trylock() {
+    return m_mutex.try_lock();
+  }
+  void unlock() {
+    m_mutex.unlock();
+  }
+
+ private:
+  std::mutex m_mutex;
+};
+
+/** Counting semaphore, as concurrent_hal.h declares it. */
+#define CONCURRENT_WAIT_FOREVER ((system_tick_t)-1)
+struct HostSemaphore {
+  std::mutex mutex;
+  std::condition_variable cond;
+  unsigned count;
+  unsigned max;
+};
+typedef HostSemaphore* os_semaphore_t;
+/** \return 0 for success. */
+int os_semaphore_create(os_semaphore_t* semaphore, unsigned max,
+                        unsigned initial);
+/** Wait up to timeout ms for a count.  \return 0 if one was taken. */
+int os_semaphore_take(os_semaphore_t semaphore, system_tick_t timeout,
+                      bool reserved);
+/** \return 0 for success, nonzero if the count is at its maximum. */
+int os_semaphore_give(os_semaphore_t semaphore, bool reserved);
+
+/** Log lines go to stdout when HOST_LOG is set in the environment. */
+class Logger {
+ public:
+  explicit Logger(const char* name) : m_name(name) {}
+  void trace(const char* format, ...) const
+    __attribute__((format(printf, 2, 3)));
+  void info(const char* format, ...) const
+    __attribute__((format(printf, 2, 3)));
+  void warn(const char* format, ...) const
+    __attribute__((format(printf, 2, 3)));
+  void error(const char* format, ...) const
+    __attribute__((format(printf, 2, 3)));
+
+ private:
+  const char* m_name;
+};
+
+class TimeClass {
+ public:
+  int year(uint32_t t);
+  int month(uint32_t t);
+  int day(uint32_t t);
+  int hour(uint32_t t);
+  int minute(uint32_t t);
+  int second(uint32_t t);
+  uint32_t now();
+};
+extern TimeClass Time;
+
+class SystemClass {
+ public:
+  uint32_t freeMemory() {
+    return 0X10000;
+  }
+};
+extern SystemClass System;
+
+class ParticleClass {
+ public:
+  bool process() {
+    return true;
+  }
+};
+extern ParticleClass Particle;
+#endif  // HOST_application_h
@@ -0,0 +1,25 @@
+/* Host build shim: application wide helpers JazaSD expects. */
+#ifndef HOST_myParticle_h
+#define HOST_myParticle_h
+#include "application.h"
+
+#define TRUE true
+#define FALSE false
+
+/** Hardware watchdog, nothing to pat on the host. */
+class HostWatchdog {
+ public:
+  void pat() {}
+};
+extern HostWatchdog HW_Watchdog;
+
+/** Run the system loop (nothing to do on the host). */
+void Particle_Process();
+
+/** Unix time used for SD timestamps and archive folder names. */
+extern uint32_t the_time;
+
+/** SD card state shared with the rest of the app. */
+extern bool SD_INITIALIZED;
+extern uint32_t last_sd_write_millis;
+#endif  // HOST_myParticle_h
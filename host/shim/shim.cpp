@@ -0,0 +1,225 @@
+/* Host build shim: definitions for the shim headers. */
+#include <time.h>
+#include "myParticle.h"
+#include "RetainedVars.h"
+#include "Debug/EscapeChars.h"
+#include "Debug/PrintHelper.h"
+#include "Publishing/JazaPublish.h"
+
+HostSerial Serial;
+SPIClass SPI;
+SPIClass SPI1;
+TimeClass Time;
+SystemClass System;
+ParticleClass Particle;
+HostWatchdog HW_Watchdog;
+HostPublish jazaPublish;
+HostTimer lastPublishTimer;
+
+uint32_t the_time = 1500000000UL;
+uint32_t last_sd_write_millis = 0;
+bool SD_RECOVERY_ATTEMPT_ACTIVE = false;
+bool SRAM_COLD_BOOT = false;
+
+const char* mes_obj_sd = "SD";
+const char* mes_buf_Small = "buffer too small";
+const char* mes_err_sanity = "sanity check failed";
+const char* mes_err_thrown = "error thrown";
+const char* mes_err_unknown = "unknown error";
+const char* mes_gen_success = "success";
+const char* mes_inValid = "invalid";
+const char* mes_sd_fileOpenError = "file open error";
+const char* mes_sd_fileSeekError = "file seek error";
+const char* mes_sd_noEntries = "no entries";
+const char* mes_sd_overWritingBytes = "overwriting bytes";
+const char* mes_sd_readError = "read error";
+const char* mes_sd_syncError = "sync error";
+const char* mes_sd_truncating = "truncating";
+const char* mes_sd_variableWidth = "variable width";
+const char* mes_sd_writeError = "write error";
+//------------------------------------------------------------------------------
+static uint64_t hostMicros() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+uint32_t micros() {
+  return hostMicros();
+}
+uint32_t millis() {
+  return hostMicros()/1000;
+}
+void delay(uint32_t) {}
+void delayMicroseconds(uint32_t) {}
+void pinMode(uint16_t, uint8_t) {}
+void digitalWrite(uint16_t pin, uint8_t value) {
+  hostSdCard.pinWrite(pin, value);
+}
+int32_t digitalRead(uint16_t) {
+  return 0;
+}
+void yield() {}
+void Particle_Process() {}
+//------------------------------------------------------------------------------
+int os_semaphore_create(os_semaphore_t* semaphore, unsigned max,
+                        unsigned initial) {
+  *semaphore = new HostSemaphore;
+  (*semaphore)->count = initial;
+  (*semaphore)->max = max;
+  return 0;
+}
+int os_semaphore_take(os_semaphore_t semaphore, system_tick_t timeout,
+                      bool) {
+  std::unique_lock<std::mutex> lock(semaphore->mutex);
+  auto ready = [semaphore] { return semaphore->count != 0; };
+  if (timeout == CONCURRENT_WAIT_FOREVER) {
+    semaphore->cond.wait(lock, ready);
+  } else if (!semaphore->cond.wait_for(lock,
+                                       std::chrono::milliseconds(timeout),
+                                       ready)) {
+    return 1;
+  }
+  semaphore->count--;
+  return 0;
+}
+int os_semaphore_give(os_semaphore_t semaphore, bool) {
+  std::lock_guard<std::mutex> lock(semaphore->mutex);
+  if (semaphore->count >= semaphore->max) {
+    return 1;
+  }
+  semaphore->count++;
+  semaphore->cond.notify_one();
+  return 0;
+}
+//------------------------------------------------------------------------------
+size_t Print::printf(const char* format, ...) {
+  char buf[256];
+  va_list ap;
+  va_start(ap, format);
+  int n = vsnprintf(buf, sizeof(buf), format, ap);
+  va_end(ap);
+  return n < 0 ? 0 : write(buf);
+}
+size_t Print::printlnf(const char* format, ...) {
+  char buf[256];
+  va_list ap;
+  va_start(ap, format);
+  int n = vsnprintf(buf, sizeof(buf), format, ap);
+  va_end(ap);
+  return n < 0 ? 0 : write(buf) + println();
+}
+//------------------------------------------------------------------------------
+static void logLine(const char* name, const char* level, const char* format,
+                    va_list ap) {
+  if (!getenv("HOST_LOG")) {
+    return;
+  }
+  printf("[%s] %s: ", name, level);
+  vprintf(format, ap);
+  printf("\n");
+}
+#define LOGGER_LEVEL(fn, level) \
+  void Logger::fn(const char* format, ...) const { \
+    va_list ap; \
+    va_start(ap, format); \
+    logLine(m_name, level, format, ap); \
+    va_end(ap); \
+  }
+LOGGER_LEVEL(trace, "TRACE")
+LOGGER_LEVEL(info, "INFO")
+LOGGER_LEVEL(warn, "WARN")
+LOGGER_LEVEL(error, "ERROR")
+//------------------------------------------------------------------------------
+static struct tm* hostTime(uint32_t t) {
+  static struct tm tmBuf;
+  time_t tt = t;
+  gmtime_r(&tt, &tmBuf);
+  return &tmBuf;
+}
+int TimeClass::year(uint32_t t) {
+  return hostTime(t)->tm_year + 1900;
+}
+int TimeClass::month(uint32_t t) {
+  return hostTime(t)->tm_mon + 1;
+}
+int TimeClass::day(uint32_t t) {
+  return hostTime(t)->tm_mday;
+}
+int TimeClass::hour(uint32_t t) {
+  return hostTime(t)->tm_hour;
+}
+int TimeClass::minute(uint32_t t) {
+  return hostTime(t)->tm_min;
+}
+int TimeClass::second(uint32_t t) {
+  return hostTime(t)->tm_sec;
+}
+uint32_t TimeClass::now() {
+  return the_time;
+}
+//------------------------------------------------------------------------------
+static void printMessage(const char* level, unsigned lineNum, const char* mes,
+                         const char* detail) {
+  if (!getenv("HOST_LOG")) {
+    return;
+  }
+  printf("%s L%u: %s%s%s\n", level, lineNum, mes, detail ? " " : "",
+         detail ? detail : "");
+}
+void printError(const Logger&, unsigned lineNum, const char* mes,
+                const char* detail) {
+  printMessage("ERROR", lineNum, mes, detail);
+}
+void printWarning(const Logger&, unsigned lineNum, const char* mes,
+                  const char* detail) {
+  printMessage("WARN", lineNum, mes, detail);
+}
+void printInfo(const Logger&, unsigned lineNum, const char* mes,
+               const char* detail) {
+  printMessage("INFO", lineNum, mes, detail);
+}
+void printTrace(const Logger&, unsigned lineNum, const char* mes,
+                const char* detail) {
+  printMessage("TRACE", lineNum, mes, detail);
+}
+void printHeaderBreak(const char*) {}
+void printFreeMem() {}
+//------------------------------------------------------------------------------
+const char* getEscapedCharString(char c) {
+  static char buf[5];
+  switch (c) {
+    case '\r':
+      return "\\r";
+    case '\n':
+      return "\\n";
+    case '\t':
+      return "\\t";
+  }
+  if (c < ' ' || c > '~') {
+    snprintf(buf, sizeof(buf), "\\x%02X", (uint8_t)c);
+  } else {
+    buf[0] = c;
+    buf[1] = 0;
+  }
+  return buf;
+}
+const char* getEscapedStr(const char* str) {
+  static char buf[512];
+  size_t n = 0;
+  buf[0] = 0;
+  for (; str && *str && n + 5 < sizeof(buf); str++) {
+    const char* esc = getEscapedCharString(*str);
+    strcpy(buf + n, esc);
+    n += strlen(esc);
+  }
+  return buf;
+}
+//------------------------------------------------------------------------------
+bool HostPublish::publishWarning(const char* object, unsigned lineNum,
+                                 const char* data, bool, int, bool) {
+  printf("WARNING %s L%u: %s\n", object, lineNum, data);
+  return true;
+}
+uint32_t HostTimer::elapsedTime() {
+  return 0XFFFFFFFF;
+}